@@ -4,14 +4,61 @@
 #include "Axionomy.h"
 #include "engine/MarketEngine.h"
 
+#include <chrono>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+
 using namespace std;
 using namespace Axionomy;
 
 
+// Scratch file in the system temporary directory, tests and benchmarks do not write to the source tree
+std::string scratchPath(const std::string& name) {
+	return (std::filesystem::temp_directory_path() / name).string();
+}
+
+
+// Generated catalog compiled to a scratch image, the image is removed with the fixture
+struct CatalogImage {
+	ProductsList products;
+	std::string path;
+
+	CatalogImage(const WorkloadConfig& config, const std::string& name) : path(scratchPath(name)) {
+		WorkloadGenerator::generateProducts(config, products);
+		ProductsLoader::saveProductImage(path, products);
+	}
+	CatalogImage(const CatalogImage&) = delete;
+	CatalogImage& operator=(const CatalogImage&) = delete;
+	~CatalogImage() { std::remove(path.c_str()); }
+};
+
+
+// Two engines over the same catalog clearing on one and on threadsCount threads, results must match exactly
+struct EnginePair {
+	ThreadPool singleThread{ 1 };
+	ThreadPool threadPool;
+	MarketEngine sequential;
+	MarketEngine parallel;
+
+	EnginePair(const std::string& imagePath, size_t threadsCount) : threadPool(threadsCount), sequential(imagePath), parallel(imagePath) {
+		sequential.setThreadPool(&singleThread);
+		parallel.setThreadPool(&threadPool);
+	}
+	std::array<MarketEngine*, 2> engines() { return { &sequential, &parallel }; }
+};
+
+
 void productLoaderTest() {
 
-	ProductsPricer marketPricer("data\\products.json");
-	const ProductsList& products = marketPricer.getProductsList();
+	ProductsPricer marketPricer("data/products.json");
+	ProductsView products = marketPricer.getProductsList();
 
 	if (products.size() == 0) {
 		cerr << "Product list load failed for some reason \n";
@@ -40,14 +87,1271 @@ void productLoaderTest() {
 }
 
 
+void productLoaderBenchmark(size_t productsCount) {
+
+	// Generate synthetic catalog of the requested size
+	CatalogImage catalog({ .productsCount = productsCount }, "benchmark_products.axc");
+	const std::string path = scratchPath("benchmark_products.json");
+	ProductsLoader::saveProductList(path, catalog.products);
+
+	auto measure = [&](const char* name, size_t (*loader)(const std::string&, ProductsList&)) {
+		ProductsList products;
+		auto start = chrono::steady_clock::now();
+		size_t count = loader(path, products);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		cout << name << ": " << count << " products in " << elapsed.count() << " ms\n";
+	};
+
+	measure("SAX loader", ProductsLoader::loadProductList);
+	measure("DOM loader", ProductsLoader::loadProductListDOM);
+
+	ProductsList products;
+	auto start = chrono::steady_clock::now();
+	size_t count = ProductsLoader::loadProductImage(catalog.path, products);
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	cout << "Image loader: " << count << " products in " << elapsed.count() << " ms\n";
+
+	// Pricer startup: linked image is assigned as stored, JSON is parsed and linked
+	auto startup = [](const char* name, const std::string& path, bool verifyImage) {
+		auto start = chrono::steady_clock::now();
+		ProductsPricer pricer(path, verifyImage);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		cout << name << ": " << pricer.getProductsCount() << " products in " << elapsed.count() << " ms\n";
+	};
+	startup("Pricer from JSON", path, false);
+	startup("Pricer from image", catalog.path, false);
+	startup("Pricer from image with checksum", catalog.path, true);
+
+	std::remove(path.c_str());
+}
+
+
+void productPricerBenchmark(size_t productsCount, size_t ticks, size_t threadsCount) {
+
+	// Generate synthetic catalog and load it to the pricer
+	CatalogImage catalog({ .productsCount = productsCount, .depth = 8, .fanIn = 5 }, "benchmark_pricer.axc");
+	ProductsPricer pricer(catalog.path);
+	ThreadPool threadPool(threadsCount);
+	pricer.setThreadPool(&threadPool);
+	cout << "Pricing on " << threadPool.getThreadsCount() << " threads over " << pricer.getLevelsCount() << " BoM levels\n";
+
+
+	// Reprice the whole catalog with slightly varying demand and supply using every supported kernel
+	const char* kernelNames[] = { "Scalar", "AVX2", "AVX512" };
+	size_t count = pricer.getProductsCount();
+	for (PricingKernel kernel : { PricingKernel::Scalar, PricingKernel::AVX2, PricingKernel::AVX512 }) {
+		if (!pricer.setPricingKernel(kernel)) continue;
+		chrono::duration<double, milli> elapsed{ 0 };
+		for (size_t tick = 0; tick < ticks; tick++) {
+			for (size_t index = 0; index < count; index++) {
+				double swing = double((index * 7919 + tick * 104729) % 2000) - 1000;
+				pricer.setMarketData(index, 10000 + swing, 10000 - swing);
+			}
+			auto start = chrono::steady_clock::now();
+			pricer.evaluatePrices();
+			elapsed += chrono::steady_clock::now() - start;
+		}
+		cout << "Pricing " << count << " products (" << kernelNames[size_t(kernel)] << "): "
+			<< elapsed.count() / double(ticks) << " ms per tick\n";
+	}
+}
+
+
+void marketClearingBenchmark(size_t productsCount, size_t ordersCount, size_t ticks, size_t threadsCount) {
+
+	// Generate synthetic catalog and load it to the engine
+	CatalogImage catalog({ .productsCount = productsCount, .depth = 8, .fanIn = 5 }, "benchmark_clearing.axc");
+	const ProductsList& generated = catalog.products;
+	MarketEngine engine(catalog.path);
+	ThreadPool threadPool(threadsCount);
+	engine.setThreadPool(&threadPool);
+	const size_t agentsCount = 1000;
+	for (size_t i = 0; i < agentsCount; i++) {
+		if (i % 2 == 0) engine.addAgent(Household{});
+		else engine.addAgent(Firm{});
+	}
+
+	// Crossing orders with skewed popularity: a few products get most of the orders
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::normal_distribution<double> price(100, 5);
+	chrono::duration<double, milli> submission{ 0 }, clearing{ 0 };
+	for (size_t tick = 0; tick < ticks; tick++) {
+		auto start = chrono::steady_clock::now();
+		for (size_t i = 0; i < ordersCount; i++) {
+			double u = uniform(random);
+			const Product& product = generated[size_t(u * u * u * double(generated.size()))];
+			AgentID agent = AgentID(random() % agentsCount);
+			engine.submitOrder(agent, product.productID, 1 + double(random() % 10), Money(std::round(price(random) * 100) / 100),
+				agent % 2 == 0 ? OrderSide::Buy : OrderSide::Sell);
+		}
+		auto submitted = chrono::steady_clock::now();
+		engine.processTick();
+		submission += submitted - start;
+		clearing += chrono::steady_clock::now() - submitted;
+	}
+	cout << "Clearing " << ordersCount << " orders of " << productsCount << " products on " << threadPool.getThreadsCount() << " threads: submission "
+		<< submission.count() / double(ticks) << " ms, tick " << clearing.count() / double(ticks) << " ms per tick\n";
+}
+
+
+
+void agentPoolsBenchmark(size_t householdsCount, size_t firmsCount, size_t ticks) {
+
+	// Small catalog, so the tick time is dominated by agents, population is loaded from generated file
+	const WorkloadConfig config{ .productsCount = 100, .householdsCount = householdsCount, .firmsCount = firmsCount };
+	CatalogImage catalog(config, "benchmark_agents.axc");
+	const std::string agentsPath = scratchPath("benchmark_agents.json");
+	WorkloadGenerator::saveAgents(agentsPath, config, catalog.products);
+	MarketEngine engine(catalog.path);
+
+	auto start = chrono::steady_clock::now();
+	size_t loaded = WorkloadGenerator::loadAgents(agentsPath, engine);
+	chrono::duration<double, milli> adding = chrono::steady_clock::now() - start;
+	std::remove(agentsPath.c_str());
+	if (loaded != householdsCount + firmsCount) {
+		cout << "Failed to load agents population\n";
+		return;
+	}
+
+	start = chrono::steady_clock::now();
+	for (size_t tick = 0; tick < ticks; tick++) engine.processTick();
+	chrono::duration<double, milli> ticking = chrono::steady_clock::now() - start;
+	cout << "Agent pools of " << householdsCount << " households and " << firmsCount << " firms: loading "
+		<< adding.count() << " ms, tick " << ticking.count() / double(ticks) << " ms per tick\n";
+}
+
+
+bool agentsPopulationTest() {
+
+	// Generated population loads back with its agent types, cash and inventories
+	const WorkloadConfig config{ .productsCount = 200, .householdsCount = 300, .firmsCount = 50 };
+	CatalogImage catalog(config, "test_agents.axc");
+	const std::string agentsPath = scratchPath("test_agents.json");
+	bool passed = WorkloadGenerator::saveAgents(agentsPath, config, catalog.products);
+	MarketEngine engine(catalog.path);
+	passed = passed && WorkloadGenerator::loadAgents(agentsPath, engine) == config.householdsCount + config.firmsCount;
+	for (AgentID agent = 0; passed && agent < engine.getAgentsCount(); agent++) {
+		const EconomicAgent& loaded = engine.getAgent(agent);
+		bool firm = agent >= config.householdsCount;
+		ProductID produced = catalog.products[(agent - config.householdsCount) % catalog.products.size()].productID;
+		passed = loaded.getAgentID() == agent && loaded.getCash() >= Money(firm ? 10000 : 1000)
+			&& (!firm || loaded.getQuantity(produced) >= 10);
+	}
+
+	// Loading again must continue agent IDs, the rejected file leaves the engine unchanged
+	size_t agentsCount = engine.getAgentsCount();
+	passed = passed && WorkloadGenerator::loadAgents(agentsPath, engine) == 0 && engine.getAgentsCount() == agentsCount;
+
+	// Schema violations are rejected before any agent is added
+	const char* invalid[] = {
+		R"([ { "agentID": 0, "cash": 1, "debt": 0 } ])",
+		R"({ "households": [ { "agentID": 0, "cash": 1, "debt": 0 } ] })",
+		R"({ "households": [ { "agentID": 0, "cash": -1, "debt": 0 } ], "firms": [] })",
+		R"({ "households": [ { "agentID": 0, "cash": 1 } ], "firms": [] })",
+		R"({ "households": [], "firms": [ { "agentID": 0, "cash": 1, "debt": 0 } ] })",
+		R"({ "households": [], "firms": [ { "agentID": 0, "product": 123456789, "cash": 1, "debt": 0 } ] })",
+		R"({ "households": [ { "agentID": 0, "cash": 1, "debt": 0, "inventory": [ { "productID": 0 } ] } ], "firms": [] })",
+		R"({ "households": [ { "agentID": 1, "cash": 1, "debt": 0 } ], "firms": [] })"
+	};
+	MarketEngine empty(catalog.path);
+	for (const char* text : invalid) {
+		std::ofstream(agentsPath, std::ios::trunc) << text;
+		passed = passed && WorkloadGenerator::loadAgents(agentsPath, empty) == 0 && empty.getAgentsCount() == 0;
+	}
+	std::remove(agentsPath.c_str());
+	cout << "Agents population of " << agentsCount << " agents round-trip " << (passed ? "PASSED" : "FAILED") << endl;
+	return passed;
+}
+
+
+bool parallelClearingTest(size_t threadsCount) {
+
+	// Two engines over the same catalog and order flow, one of them clears products in parallel
+	CatalogImage catalog({ .productsCount = 500 }, "test_clearing.axc");
+	const ProductsList& generated = catalog.products;
+	EnginePair pair(catalog.path, threadsCount);
+	MarketEngine& sequential = pair.sequential;
+	MarketEngine& parallel = pair.parallel;
+	const size_t agentsCount = 100;
+	for (MarketEngine* engine : pair.engines()) {
+		for (size_t i = 0; i < agentsCount; i++) engine->addAgent(Household{});
+	}
+
+	// Orders of one tick and good-till-cancelled orders, skewed over products
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::normal_distribution<double> price(100, 5);
+	for (size_t tick = 0; tick < 5; tick++) {
+		for (size_t i = 0; i < 50000; i++) {
+			double u = uniform(random);
+			ProductID productID = generated[size_t(u * u * double(generated.size()))].productID;
+			AgentID agent = AgentID(random() % agentsCount);
+			Quantity quantity = 1 + double(random() % 10);
+			Money limitPrice(std::round(price(random) * 100) / 100);
+			OrderSide side = random() % 2 == 0 ? OrderSide::Buy : OrderSide::Sell;
+			bool standing = i % 10 == 0;
+			for (MarketEngine* engine : pair.engines()) {
+				OrderHandle handle;
+				if (standing) engine->submitOrder(agent, productID, quantity, limitPrice, side, handle);
+				else engine->submitOrder(agent, productID, quantity, limitPrice, side);
+			}
+		}
+		sequential.processTick();
+		parallel.processTick();
+	}
+
+	// Balances, inventories and volumes must match exactly
+	size_t mismatches = 0;
+	for (AgentID agent = 0; agent < agentsCount; agent++) {
+		if (sequential.getAgent(agent).getCash() != parallel.getAgent(agent).getCash()) mismatches++;
+		for (const Product& product : generated) {
+			if (sequential.getAgent(agent).getQuantity(product.productID) != parallel.getAgent(agent).getQuantity(product.productID)) mismatches++;
+		}
+	}
+	Quantity traded = 0;
+	for (ProductIndex index = 0; index < generated.size(); index++) {
+		if (sequential.getPriceHistory().getVolume(index) != parallel.getPriceHistory().getVolume(index)) mismatches++;
+		traded += sequential.getPriceHistory().getVolume(index);
+	}
+	mismatches += sequential.getLimitOrderBook().getOrdersCount() != parallel.getLimitOrderBook().getOrdersCount();
+	cout << "Parallel clearing on " << pair.threadPool.getThreadsCount() << " threads, last tick traded " << traded << ": " << mismatches << " mismatches"
+		<< (mismatches == 0 ? " PASSED" : " FAILED") << endl;
+	return mismatches == 0;
+}
+
+
+bool constrainedAuctionTest(size_t threadsCount) {
+
+	// Household with 1000 bids 10@100 for chairs and wood, gets half of each.
+	// Firm 3 holds 3 chairs and asks 10@80, it sells its 3 chairs only
+	MarketEngine engine("data/products.json");
+	engine.setClearingMode(ClearingMode::ConstrainedAuction);
+	const ProductID wood = 1, chair = 2;
+	AgentID household = engine.addAgent(Household{});
+	AgentID firm = engine.addAgent(Firm{});
+	AgentID smallFirm = engine.addAgent(Firm{});
+	engine.deposit(household, Money(1000));
+	engine.deposit(firm, chair, 100);
+	engine.deposit(firm, wood, 100);
+	engine.deposit(smallFirm, chair, 3);
+	engine.submitOrder(household, chair, 10, Money(100), OrderSide::Buy);
+	engine.submitOrder(household, wood, 10, Money(100), OrderSide::Buy);
+	engine.submitOrder(firm, chair, 20, Money(90), OrderSide::Sell);
+	engine.submitOrder(firm, wood, 20, Money(90), OrderSide::Sell);
+	engine.submitOrder(smallFirm, chair, 10, Money(80), OrderSide::Sell);
+	engine.processTick();
+	const EconomicAgent& buyer = engine.getAgent(household);
+	bool passed = std::abs(buyer.getQuantity(chair) - 5) < 1e-6 && std::abs(buyer.getQuantity(wood) - 5) < 1e-6;
+	passed = passed && buyer.getCash() >= Money(0) && engine.getAgent(smallFirm).getQuantity(chair) == 0;
+	passed = passed && std::abs(engine.getAgent(firm).getQuantity(chair) - 98) < 1e-6;
+	cout << "Constrained auction: household cash " << double(buyer.getCash()) << ", chairs " << buyer.getQuantity(chair)
+		<< ", wood " << buyer.getQuantity(wood) << (passed ? " PASSED" : " FAILED") << endl;
+
+	// Unaffordable bid crosses resting ask and is dropped by budgets, resting orders that did not trade stay open
+	MarketEngine resting("data/products.json");
+	resting.setClearingMode(ClearingMode::ConstrainedAuction);
+	AgentID seller = resting.addAgent(Firm{});
+	AgentID funded = resting.addAgent(Household{});
+	AgentID broke = resting.addAgent(Household{});
+	resting.deposit(seller, chair, 100);
+	resting.deposit(funded, Money(10000));
+	OrderHandle ask = NO_ORDER, bid = NO_ORDER;
+	resting.submitOrder(seller, chair, 10, Money(100), OrderSide::Sell, ask);
+	resting.submitOrder(funded, chair, 10, Money(90), OrderSide::Buy, bid);
+	resting.submitOrder(broke, chair, 10, Money(105), OrderSide::Buy);
+	resting.processTick();
+	const LimitOrderBook& book = resting.getLimitOrderBook();
+	bool kept = resting.getAgent(seller).getQuantity(chair) == 100 && resting.getAgent(seller).getCash() == Money(0)
+		&& book.getRestingQuantity(ask) == 10 && book.getRestingQuantity(bid) == 10;
+	cout << "Constrained auction: resting ask " << book.getRestingQuantity(ask) << " after unaffordable crossing bid"
+		<< (kept ? " PASSED" : " FAILED") << endl;
+	passed = passed && kept;
+
+	// Bids with a price typo overflow money units, their reservation saturates and gets no share
+	MarketEngine typo("data/products.json");
+	typo.setClearingMode(ClearingMode::ConstrainedAuction);
+	AgentID vendor = typo.addAgent(Firm{});
+	AgentID whale = typo.addAgent(Household{});
+	AgentID honest = typo.addAgent(Household{});
+	typo.deposit(vendor, chair, 100);
+	typo.deposit(whale, Money(10000));
+	typo.deposit(honest, Money(10000));
+	typo.submitOrder(vendor, chair, 20, Money(90), OrderSide::Sell);
+	typo.submitOrder(whale, chair, 1e9, Money(1e12), OrderSide::Buy);
+	typo.submitOrder(whale, wood, 1e9, Money(1e12), OrderSide::Buy);
+	typo.submitOrder(honest, chair, 10, Money(100), OrderSide::Buy);
+	typo.processTick();
+	bool saturated = typo.getAgent(whale).getCash() == Money(10000) && typo.getAgent(whale).getQuantity(chair) == 0
+		&& typo.getAgent(honest).getQuantity(chair) == 10 && typo.getAgent(honest).getCash() >= Money(0);
+	cout << "Constrained auction: overflowing bids of agent with cash " << double(typo.getAgent(whale).getCash()) << " get no share"
+		<< (saturated ? " PASSED" : " FAILED") << endl;
+	passed = passed && saturated;
+
+	// Random endowments and overspending order flow on 1 and N threads
+	CatalogImage catalog({ .productsCount = 300 }, "test_budgets.axc");
+	const ProductsList& generated = catalog.products;
+	EnginePair pair(catalog.path, threadsCount);
+	MarketEngine& sequential = pair.sequential;
+	MarketEngine& parallel = pair.parallel;
+	const size_t agentsCount = 100;
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> uniform(0, 1);
+	std::normal_distribution<double> price(100, 5);
+	for (MarketEngine* engine : pair.engines()) {
+		engine->setClearingMode(ClearingMode::ConstrainedAuction);
+		for (size_t i = 0; i < agentsCount; i++) engine->addAgent(Household{});
+	}
+	for (AgentID agent = 0; agent < agentsCount; agent++) {
+		Money cash(std::round(uniform(random) * 500000) / 100);
+		for (MarketEngine* engine : pair.engines()) engine->deposit(agent, cash);
+		for (size_t i = 0; i < 20; i++) {
+			ProductID productID = generated[random() % generated.size()].productID;
+			Quantity quantity = double(random() % 50);
+			for (MarketEngine* engine : pair.engines()) engine->deposit(agent, productID, quantity);
+		}
+	}
+	for (size_t tick = 0; tick < 5; tick++) {
+		for (size_t i = 0; i < 20000; i++) {
+			double u = uniform(random);
+			ProductID productID = generated[size_t(u * u * double(generated.size()))].productID;
+			AgentID agent = AgentID(random() % agentsCount);
+			Quantity quantity = 1 + double(random() % 20);
+			Money limitPrice(std::round(price(random) * 100) / 100);
+			OrderSide side = random() % 2 == 0 ? OrderSide::Buy : OrderSide::Sell;
+			for (MarketEngine* engine : pair.engines()) engine->submitOrder(agent, productID, quantity, limitPrice, side);
+		}
+		sequential.processTick();
+		parallel.processTick();
+	}
+	size_t mismatches = 0, negatives = 0;
+	double traded = 0;
+	for (AgentID agent = 0; agent < agentsCount; agent++) {
+		const EconomicAgent& a = sequential.getAgent(agent);
+		const EconomicAgent& b = parallel.getAgent(agent);
+		mismatches += a.getCash() != b.getCash();
+		negatives += a.getCash() < Money(0);
+		for (const Product& product : generated) {
+			mismatches += a.getQuantity(product.productID) != b.getQuantity(product.productID);
+			negatives += a.getQuantity(product.productID) < 0;
+		}
+	}
+	for (ProductIndex index = 0; index < generated.size(); index++) traded += sequential.getPriceHistory().getVolume(index);
+	bool consistent = mismatches == 0 && negatives == 0 && traded > 0;
+	cout << "Constrained auction on " << pair.threadPool.getThreadsCount() << " threads, last tick traded " << traded << ": "
+		<< mismatches << " mismatches, " << negatives << " negative balances" << (consistent ? " PASSED" : " FAILED") << endl;
+	return passed && consistent;
+}
+
+
+bool parallelPricingTest(size_t threadsCount) {
+
+	// Two pricers over the same catalog, one of them evaluates BoM levels in parallel
+	CatalogImage catalog({ .productsCount = 50000, .depth = 10, .fanIn = 6 }, "test_levels.axc");
+	ProductsPricer sequential(catalog.path);
+	ProductsPricer parallel(catalog.path);
+	ThreadPool threadPool(threadsCount);
+	parallel.setThreadPool(&threadPool);
+
+	size_t count = sequential.getProductsCount();
+	for (size_t tick = 0; tick < 10; tick++) {
+		for (size_t index = 0; index < count; index++) {
+			double swing = double((index * 7919 + tick * 104729) % 2000) - 1000;
+			sequential.setMarketData(index, 10000 + swing, 10000 - swing);
+			parallel.setMarketData(index, 10000 + swing, 10000 - swing);
+		}
+		sequential.evaluatePrices();
+		parallel.evaluatePrices();
+	}
+
+	size_t mismatches = 0;
+	for (size_t index = 0; index < count; index++) {
+		if (sequential.getPrice(index) != parallel.getPrice(index)) mismatches++;
+	}
+	cout << "Parallel pricing on " << threadPool.getThreadsCount() << " threads over " << parallel.getLevelsCount()
+		<< " BoM levels: " << mismatches << " mismatches of " << count << " prices "
+		<< (mismatches == 0 ? "PASSED" : "FAILED") << endl;
+	return mismatches == 0;
+}
+
+
+bool incrementalPricingTest(size_t productsCount, size_t ticks, double epsilon) {
+
+	// Full and incremental pricers over the same catalog
+	CatalogImage catalog({ .productsCount = productsCount, .depth = 8, .fanIn = 5 }, "test_incremental.axc");
+	ProductsPricer full(catalog.path);
+	ProductsPricer incremental(catalog.path);
+	incremental.setIncrementalPricing(true, epsilon);
+
+	// Calm market: starts balanced, every tick a few products see a small imbalance
+	size_t count = full.getProductsCount();
+	for (size_t index = 0; index < count; index++) {
+		full.setMarketData(index, 10000, 10000);
+		incremental.setMarketData(index, 10000, 10000);
+	}
+	full.evaluatePrices();
+	incremental.evaluatePrices();
+	chrono::duration<double, milli> fullElapsed{ 0 }, incrementalElapsed{ 0 };
+	size_t repriced = 0;
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> imbalance(0.98, 1.02);
+	for (size_t tick = 0; tick < ticks; tick++) {
+		for (size_t changes = 0; changes < count / 10000; changes++) {
+			size_t index = random() % count;
+			double demand = 10000 * imbalance(random);
+			full.setMarketData(index, demand, 10000);
+			incremental.setMarketData(index, demand, 10000);
+		}
+		auto start = chrono::steady_clock::now();
+		full.evaluatePrices();
+		auto middle = chrono::steady_clock::now();
+		incremental.evaluatePrices();
+		incrementalElapsed += chrono::steady_clock::now() - middle;
+		fullElapsed += middle - start;
+		repriced += incremental.getRepricedCount();
+	}
+
+	double maxError = 0;
+	for (size_t index = 0; index < count; index++) {
+		double error = std::abs(incremental.getPrice(index) - full.getPrice(index)) / std::abs(full.getPrice(index));
+		maxError = std::max(maxError, error);
+	}
+	bool passed = maxError < epsilon * 1000;
+	cout << "Incremental pricing of " << count << " products: " << repriced / ticks << " repriced per tick, "
+		<< incrementalElapsed.count() / double(ticks) << " ms vs " << fullElapsed.count() / double(ticks)
+		<< " ms per tick, max relative error " << maxError << (passed ? " PASSED" : " FAILED") << endl;
+	return passed;
+}
+
+
+bool fastForwardTest(size_t productsCount, size_t ticks) {
+
+	// Stepped and fast-forwarded pricers over the same catalog
+	CatalogImage catalog({ .productsCount = productsCount, .depth = 8, .fanIn = 5 }, "test_fast_forward.axc");
+	ProductsPricer stepped(catalog.path);
+	ProductsPricer skipped(catalog.path);
+
+	// Balanced market except final goods, that are out of balance before the idle period, and a few
+	// inputs slightly out of balance, which are within the loose epsilon but still move
+	size_t count = stepped.getProductsCount();
+	for (size_t index = 0; index < count; index++) {
+		double demand = index >= count * 7 / 8 ? 10000 + double((index * 7919) % 2000) - 1000 : index % 64 == 0 ? 10100 : 10000;
+		stepped.setMarketData(index, demand, 10000);
+		skipped.setMarketData(index, demand, 10000);
+	}
+	skipped.setIncrementalPricing(false, 0.5);   // loose incremental epsilon must not loosen fast-forward
+
+	auto start = chrono::steady_clock::now();
+	for (size_t tick = 0; tick < ticks; tick++) stepped.evaluatePrices();
+	auto middle = chrono::steady_clock::now();
+	skipped.fastForward(ticks);
+	chrono::duration<double, milli> steppedElapsed = middle - start;
+	chrono::duration<double, milli> skippedElapsed = chrono::steady_clock::now() - middle;
+
+	double maxError = 0;
+	for (size_t index = 0; index < count; index++) {
+		double error = std::abs(skipped.getPrice(index) - stepped.getPrice(index)) / std::abs(stepped.getPrice(index));
+		maxError = std::max(maxError, error);
+	}
+	bool passed = maxError < 1e-6;
+	cout << "Fast-forward of " << count << " products by " << ticks << " ticks: " << skippedElapsed.count()
+		<< " ms vs " << steppedElapsed.count() << " ms stepped, max relative error " << maxError
+		<< (passed ? " PASSED" : " FAILED") << endl;
+	return passed;
+}
+
+
+bool moneyTest() {
+
+	// Trade values of one tick, summed by worker in dynamic chunks on pools of different size
+	const size_t count = 1000000;
+	const size_t chunkSize = 10000;
+	std::vector<Money> values(count);
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> price(0.01, 10000), quantity(0.1, 1000);
+	for (Money& value : values) value = Money(price(random)) * quantity(random);
+
+	std::vector<Money> totals;
+	for (size_t threadsCount : { 1, 2, 3, 4, 8 }) {
+		ThreadPool threadPool(threadsCount);
+		std::vector<Money> partial(threadPool.getThreadsCount(), Money(0));
+		threadPool.parallelFor(count / chunkSize, [&](size_t chunk, size_t worker) {
+			for (size_t i = chunk * chunkSize; i < (chunk + 1) * chunkSize; i++) partial[worker] += values[i];
+		});
+		Money total(0);
+		for (Money sum : partial) total += sum;
+		totals.push_back(total);
+	}
+
+	bool exact = std::all_of(totals.begin(), totals.end(), [&](Money total) { return total == totals[0]; });
+#if defined(AXIONOMY_FIXED_MONEY)
+	cout << "Fixed-point money total " << std::setprecision(17) << double(totals[0]) << std::setprecision(6)
+		<< (exact ? " is independent of threads count PASSED" : " depends on threads count FAILED") << endl;
+	return exact;
+#else
+	cout << "Floating-point money total " << std::setprecision(17) << double(totals[0]) << std::setprecision(6)
+		<< (exact ? " matched" : " depends on summation order") << ", build with AXIONOMY_FIXED_MONEY for exact totals" << endl;
+	return true;
+#endif
+}
+
+
+bool priceHistoryTest() {
+
+	// Random market data of a few products recorded over many windows
+	const size_t productsCount = 37;
+	const size_t capacity = 8;
+	const size_t ticks = 1000;
+	PriceHistory history(capacity);
+	ProductsState state;
+	state.resize(productsCount);
+	std::vector<std::vector<Price>> prices(productsCount);
+	std::vector<std::vector<Quantity>> volumes(productsCount);
+	std::vector<Price> ema(productsCount);
+	std::vector<Quantity> volume(productsCount);
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> price(10, 20), quantity(0, 100);
+	double maxError = 0;
+	bool lagsMatch = true;
+
+	for (size_t tick = 0; tick < ticks; tick++) {
+		for (size_t i = 0; i < productsCount; i++) {
+			state.price[i] = price(random);
+			volume[i] = i % 5 == 0 ? 0 : quantity(random);
+			prices[i].push_back(state.price[i]);
+			volumes[i].push_back(volume[i]);
+			ema[i] = tick == 0 ? state.price[i] : ema[i] + 2.0 / (capacity + 1) * (state.price[i] - ema[i]);
+		}
+		history.record(state, volume.data());
+
+		// Brute force statistics over the window
+		size_t depth = std::min(tick + 1, capacity);
+		for (size_t i = 0; i < productsCount; i++) {
+			double sum = 0, value = 0, traded = 0, changes = 0, squares = 0;
+			for (size_t lag = 0; lag < depth; lag++) {
+				size_t t = tick - lag;
+				lagsMatch &= history.getPrice(ProductIndex(i), lag) == prices[i][t];
+				sum += prices[i][t];
+				value += prices[i][t] * volumes[i][t];
+				traded += volumes[i][t];
+				if (lag + 1 < depth) {
+					double change = prices[i][t] / prices[i][t - 1] - 1;
+					changes += change;
+					squares += change * change;
+				}
+			}
+			double mean = sum / depth;
+			double vwap = traded > 0 ? value / traded : mean;
+			double volatility = depth > 1 ? std::sqrt(std::max(0.0, squares / (depth - 1) - std::pow(changes / (depth - 1), 2))) : 0;
+			maxError = std::max({ maxError, std::abs(history.getMean(ProductIndex(i)) - mean) / mean,
+				std::abs(history.getVWAP(ProductIndex(i)) - vwap) / vwap,
+				std::abs(history.getEMA(ProductIndex(i)) - ema[i]) / ema[i],
+				std::abs(history.getVolatility(ProductIndex(i)) - volatility) });
+		}
+	}
+
+	bool passed = lagsMatch && maxError < 1e-9;
+	cout << "Price history of " << productsCount << " products over " << ticks << " ticks, window " << capacity
+		<< ": lags " << (lagsMatch ? "match" : "MISMATCH") << ", max statistics error " << maxError
+		<< (passed ? " PASSED" : " FAILED") << endl;
+	return passed;
+}
+
+
+bool pricingKernelsTest() {
+
+	// Random market data with edge cases: empty market, zero supply, zero importance, huge imbalance
+	const size_t count = 100003;
+	std::vector<Quantity> demand(count), supply(count);
+	std::vector<double> importance(count), reference(count), multiplier(count);
+	std::mt19937_64 random(2025);
+	std::uniform_real_distribution<double> quantity(0, 1e6), unit(0, 1);
+	for (size_t i = 0; i < count; i++) {
+		demand[i] = i % 17 == 0 ? 0 : quantity(random);
+		supply[i] = i % 19 == 0 ? 0 : quantity(random);
+		importance[i] = i % 23 == 0 ? 0 : unit(random);
+		if (i % 29 == 0) demand[i] = supply[i] * (1 + unit(random) * 1e-3);
+	}
+	PricingKernels::evaluateMultipliers(PricingKernel::Scalar, demand.data(), supply.data(), importance.data(), reference.data(), count);
+
+	// Every precision mode of every kernel against the double scalar reference
+	const char* kernelNames[] = { "Scalar", "AVX2", "AVX512" };
+	const char* precisionNames[] = { "double", "float", "fast float" };
+	bool passed = true;
+	for (PricingPrecision precision : { PricingPrecision::Double, PricingPrecision::Float, PricingPrecision::FastFloat }) {
+		for (PricingKernel kernel : { PricingKernel::Scalar, PricingKernel::AVX2, PricingKernel::AVX512 }) {
+			if (kernel == PricingKernel::Scalar && precision == PricingPrecision::Double) continue;
+			if (!PricingKernels::isSupported(kernel)) {
+				cout << kernelNames[size_t(kernel)] << " kernel is not supported by CPU, skipped" << endl;
+				continue;
+			}
+			auto start = chrono::steady_clock::now();
+			PricingKernels::evaluateMultipliers(kernel, demand.data(), supply.data(), importance.data(), multiplier.data(), count, precision);
+			chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+			double maxError = 0;
+			for (size_t i = 0; i < count; i++) {
+				maxError = std::max(maxError, std::abs(multiplier[i] - reference[i]) / reference[i]);
+			}
+			bool kernelPassed = maxError <= PricingKernels::getTolerance(precision);
+			passed &= kernelPassed;
+			cout << kernelNames[size_t(kernel)] << " " << precisionNames[size_t(precision)] << " kernel max relative error "
+				<< maxError << " in " << elapsed.count() << " ms" << (kernelPassed ? " passed" : " FAILED") << endl;
+		}
+	}
+	return passed;
+}
+
+
+bool sameProducts(const ProductsList& a, const ProductsList& b) {
+	if (a.size() != b.size()) return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		const Product& x = a[i];
+		const Product& y = b[i];
+		bool same = x.productID == y.productID && x.type == y.type && x.unit == y.unit
+			&& x.price == y.price && x.cost == y.cost && x.demand == y.demand && x.supply == y.supply
+			&& x.importance == y.importance && x.floorMargin == y.floorMargin && x.turnover == y.turnover
+			&& x.name == y.name && x.materials.size() == y.materials.size();
+		for (size_t m = 0; same && m < x.materials.size(); m++) {
+			same = x.materials[m].productID == y.materials[m].productID
+				&& x.materials[m].quantity == y.materials[m].quantity;
+		}
+		if (!same) {
+			cerr << "Product #" << i << " differs (productID " << x.productID << ")\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+
+// Catalog entry in JSON text, IDs are written verbatim, so they may exceed the precision of double
+std::string productJSON(const std::string& productID, const std::vector<std::string>& inputs = {}) {
+	std::string materials;
+	for (const std::string& input : inputs) {
+		materials += (materials.empty() ? "{ \"input\": " : ", { \"input\": ") + input + ", \"quantity\": 1 }";
+	}
+	return "{ \"productID\": " + productID + ", \"name\": \"Product " + productID + "\", \"type\": \"Good\", \"unit\": \"Piece\", "
+		"\"price\": 10, \"cost\": 10, \"demand\": 100, \"supply\": 100, \"importance\": 0.5, \"floorMargin\": 0.1, "
+		"\"turnover\": 5, \"materials\": [ " + materials + " ] }";
+}
+
+
+// Writes catalog of entries to a scratch file and returns its path
+std::string writeCatalog(const std::string& name, const std::vector<std::string>& entries) {
+	const std::string path = scratchPath(name);
+	std::ofstream catalogFile(path, std::ios::trunc);
+	catalogFile << "[\n";
+	for (size_t i = 0; i < entries.size(); i++) catalogFile << "  " << entries[i] << (i + 1 < entries.size() ? ",\n" : "\n");
+	catalogFile << "]\n";
+	return path;
+}
+
+
+bool productListTest() {
+
+	// IDs above 2^53 stay exact: 2^53 and 2^53 + 1 are different products, the second consumes the first
+	const std::string path = writeCatalog("test_large_ids.json",
+		{ productJSON("9007199254740992"), productJSON("9007199254740993", { "9007199254740992" }) });
+	ProductsList streamed, parsed;
+	bool passed = ProductsLoader::loadProductList(path, streamed) == 2 && ProductsLoader::loadProductListDOM(path, parsed) == 2;
+	passed = passed && streamed[0].productID == 9007199254740992ULL && streamed[1].productID == 9007199254740993ULL;
+	passed = passed && streamed[1].materials.size() == 1 && streamed[1].materials[0].productID == 9007199254740992ULL;
+	passed = passed && sameProducts(streamed, parsed);
+	std::remove(path.c_str());
+	cout << "Catalog IDs above 2^53 load exactly " << (passed ? "PASSED" : "FAILED") << endl;
+	return passed;
+}
+
+
+// Product with given inputs, other fields are valid constants
+Product makeProduct(ProductID productID, const std::vector<ProductID>& inputs = {}) {
+	Product product{ productID, ProductType::Good, ProductUnit::Piece, 10, 10, 100, 100, 0.5, 0.1, 5, "Product " + std::to_string(productID), {} };
+	for (ProductID input : inputs) product.materials.push_back({ input, 1 });
+	return product;
+}
+
+
+// Links catalog and captures the diagnostics the linker writes to the error stream
+bool linkCatalog(ProductsList& products, std::string& diagnostics) {
+	std::ostringstream errors;
+	std::streambuf* console = std::cerr.rdbuf(errors.rdbuf());
+	bool linked = ProductsLoader::linkProductList(products);
+	std::cerr.rdbuf(console);
+	diagnostics = errors.str();
+	return linked;
+}
+
+
+bool catalogLinkerTest() {
+
+	// Products listed before their inputs are stored level by level, every product after its inputs
+	ProductsList products = { makeProduct(3, { 1, 2 }), makeProduct(2, { 0 }), makeProduct(4, { 3, 0 }), makeProduct(1), makeProduct(0) };
+	std::string diagnostics;
+	bool ordered = linkCatalog(products, diagnostics) && products.size() == 5 && diagnostics.empty();
+	std::vector<size_t> position(5);
+	for (size_t index = 0; ordered && index < products.size(); index++) position[products[index].productID] = index;
+	for (const Product& product : products) {
+		for (const Item& material : product.materials) ordered = ordered && position[material.productID] < position[product.productID];
+	}
+	ordered = ordered && std::max(position[0], position[1]) < position[2] && position[2] < position[3] && position[3] < position[4];
+	cout << "Catalog linker orders products listed out of order " << (ordered ? "PASSED" : "FAILED") << endl;
+
+	// Missing inputs and duplicate IDs are reported with their product IDs
+	products = { makeProduct(0), makeProduct(5, { 0, 7 }) };
+	bool missing = !linkCatalog(products, diagnostics) && diagnostics.find("Product 5 requires missing input 7") != std::string::npos;
+	products = { makeProduct(0), makeProduct(4, { 0 }), makeProduct(4) };
+	bool duplicate = !linkCatalog(products, diagnostics) && diagnostics.find("Duplicate productID 4") != std::string::npos;
+	cout << "Catalog linker reports missing inputs " << (missing ? "PASSED" : "FAILED")
+		<< ", duplicate IDs " << (duplicate ? "PASSED" : "FAILED") << endl;
+
+	// Cycle 10 -> 11 -> 12 -> 10 and self-loop of 20 are reported by their product IDs, acyclic 13 is not
+	products = { makeProduct(10, { 12 }), makeProduct(11, { 10 }), makeProduct(12, { 11 }), makeProduct(13, { 10 }), makeProduct(20, { 20 }) };
+	bool cycle = !linkCatalog(products, diagnostics);
+	std::istringstream lines(diagnostics);
+	std::vector<std::vector<ProductID>> cycles;
+	for (std::string line; std::getline(lines, line);) {
+		const std::string prefix = "Bill of materials cycle between products:";
+		if (line.rfind(prefix, 0) != 0) continue;
+		std::istringstream ids(line.substr(prefix.size()));
+		std::vector<ProductID>& reported = cycles.emplace_back();
+		for (ProductID id; ids >> id;) reported.push_back(id);
+		std::sort(reported.begin(), reported.end());
+	}
+	std::sort(cycles.begin(), cycles.end());
+	cycle = cycle && cycles == std::vector<std::vector<ProductID>>{ { 10, 11, 12 }, { 20 } };
+	cout << "Catalog linker reports cycles by product IDs " << (cycle ? "PASSED" : "FAILED") << endl;
+	return ordered && missing && duplicate && cycle;
+}
+
+
+bool catalogShardsTest() {
+
+	// Generated catalog split round-robin into shards, so inputs of most products are in other shards.
+	// Shard 0 is both JSON and its compiled image of the same stem, shards 2 and 3 are images only
+	ProductsList generated;
+	WorkloadGenerator::generateProducts({ .productsCount = 2000, .depth = 5 }, generated);
+	const std::filesystem::path directory = scratchPath("test_shards");
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::vector<ProductsList> shards(4);
+	for (size_t i = 0; i < generated.size(); i++) shards[i % shards.size()].push_back(generated[i]);
+	auto shardPath = [&](const std::string& name) { return (directory / name).string(); };
+	bool passed = ProductsLoader::saveProductList(shardPath("shard_0.json"), shards[0])
+		&& ProductsLoader::saveProductImage(shardPath("shard_0.axc"), shards[0])
+		&& ProductsLoader::saveProductList(shardPath("shard_1.json"), shards[1])
+		&& ProductsLoader::saveProductImage(shardPath("shard_2.axc"), shards[2])
+		&& ProductsLoader::saveProductImage(shardPath("shard_3.axc"), shards[3]);
+	auto writeManifest = [&](const std::string& name, const json& shardNames) {
+		std::ofstream(shardPath(name), std::ios::trunc) << json{ { "shards", shardNames } }.dump();
+		return shardPath(name);
+	};
+
+	// Directory and manifest merge the same shards into the same catalog on 1 and 4 threads
+	ThreadPool singleThread(1), threadPool(4);
+	ProductsList sequential, parallel, manifested;
+	const std::string manifest = writeManifest("catalog.manifest", { "shard_0.json", "shard_1.json", "shard_2.axc", "shard_3.axc" });
+	passed = passed && ProductsLoader::loadProductList(directory.string(), sequential, &singleThread) == generated.size();
+	passed = passed && ProductsLoader::loadProductList(directory.string(), parallel, &threadPool) == generated.size();
+	passed = passed && ProductsLoader::loadProductList(manifest, manifested, &threadPool) == generated.size();
+	passed = passed && sameProducts(sequential, parallel) && sameProducts(sequential, manifested);
+	std::vector<ProductID> ids;
+	for (const Product& product : sequential) ids.push_back(product.productID);
+	std::sort(ids.begin(), ids.end());
+	for (size_t i = 0; passed && i < ids.size(); i++) passed = ids[i] == generated[i].productID;
+	cout << "Catalog shards merge deterministically on 1 and 4 threads " << (passed ? "PASSED" : "FAILED") << endl;
+
+	// Duplicate across shards, missing inputs of an absent shard and a missing shard file fail the load
+	ProductsList rejected;
+	ProductsLoader::saveProductList(shardPath("duplicate.json"), ProductsList{ shards[1].front() });
+	bool duplicate = ProductsLoader::loadProductList(directory.string(), rejected) == 0 && rejected.empty();
+	std::filesystem::remove(shardPath("duplicate.json"));
+	bool missing = ProductsLoader::loadProductList(writeManifest("partial.manifest", { "shard_1.json", "shard_2.axc", "shard_3.axc" }), rejected) == 0;
+	bool absent = ProductsLoader::loadProductList(writeManifest("absent.manifest", { "shard_0.json", "absent.json" }), rejected) == 0;
+	std::filesystem::remove_all(directory);
+	cout << "Catalog shards reject cross-shard duplicates " << (duplicate ? "PASSED" : "FAILED") << ", missing inputs "
+		<< (missing ? "PASSED" : "FAILED") << ", missing shard files " << (absent ? "PASSED" : "FAILED") << endl;
+	return passed && duplicate && missing && absent;
+}
+
+
+bool productImageTest(const std::string& path) {
+
+	const std::string name = std::filesystem::path(path).filename().string();
+	const std::string imagePath = scratchPath(name + ".test.axc");
+	const std::string jsonPath = scratchPath(name + ".test.json");
+
+	ProductsList source, compiled, decompiled;
+	bool passed = ProductsLoader::loadProductList(path, source) > 0
+		&& ProductsLoader::saveProductImage(imagePath, source)              // JSON -> image
+		&& ProductsLoader::loadProductImage(imagePath, compiled) > 0
+		&& sameProducts(source, compiled)
+		&& ProductsLoader::saveProductList(jsonPath, compiled)              // image -> JSON
+		&& ProductsLoader::loadProductList(jsonPath, decompiled) > 0
+		&& sameProducts(source, decompiled);
+
+	std::remove(imagePath.c_str());
+	std::remove(jsonPath.c_str());
+
+	cout << "Products image round-trip " << (passed ? "passed" : "FAILED") << ": " << path << endl;
+	return passed;
+}
+
+
+// Products of the pricer in dense index order
+ProductsList pricerProducts(const ProductsPricer& pricer) {
+	ProductsList products;
+	ProductsView view = pricer.getProductsList();
+	for (size_t index = 0; index < view.size(); index++) products.push_back(view[index]);
+	return products;
+}
+
+
+bool linkedImageTest() {
+
+	// Generated multi-level catalog in linked order compiled to a linked image and to JSON
+	ProductsList generated;
+	WorkloadGenerator::generateProducts({ .productsCount = 5000, .depth = 6, .fanIn = 4 }, generated);
+	const std::string imagePath = scratchPath("test_linked.axc");
+	const std::string jsonPath = scratchPath("test_linked.json");
+	ProductsList compiled;
+	bool passed = ProductsLoader::linkProductList(generated)
+		&& ProductsLoader::saveProductImage(imagePath, generated) && ProductsLoader::saveProductList(jsonPath, generated)
+		&& ProductsLoader::loadProductImage(imagePath, compiled, true) == generated.size()
+		&& sameProducts(generated, compiled);
+
+	// Pricer takes order, levels and BoM rows from the image, prices evolve exactly as from JSON
+	ProductsPricer mapped(imagePath, true), parsed(jsonPath);
+	passed = passed && mapped.getLevelsCount() == 6 && mapped.getLevelsCount() == parsed.getLevelsCount();
+	passed = passed && sameProducts(pricerProducts(mapped), pricerProducts(parsed));
+	for (size_t tick = 0; passed && tick < 5; tick++) {
+		for (size_t index = 0; index < generated.size(); index += 7) {
+			mapped.setMarketData(index, 100 + double(tick * index % 50), 100);
+			parsed.setMarketData(index, 100 + double(tick * index % 50), 100);
+		}
+		mapped.evaluatePrices();
+		parsed.evaluatePrices();
+		for (size_t index = 0; index < generated.size(); index++) passed = passed && mapped.getPrice(index) == parsed.getPrice(index);
+	}
+	cout << "Linked image round-trip and pricing over " << mapped.getLevelsCount() << " BoM levels " << (passed ? "PASSED" : "FAILED") << endl;
+
+	// Damaged copies of the image: header fields are read at their offsets in the ImageHeader layout
+	std::ifstream imageFile(imagePath, std::ios::binary);
+	std::vector<char> image((std::istreambuf_iterator<char>(imageFile)), std::istreambuf_iterator<char>());
+	auto field = [&image](size_t offset) { uint64_t value; std::memcpy(&value, image.data() + offset, sizeof(value)); return value; };
+	const uint64_t productsOffset = field(48), materialsCount = field(32), inputsOffset = field(80), stringsOffset = field(88);
+	auto loadDamaged = [&](size_t offset, const auto& value, bool verifyChecksum) {
+		std::vector<char> damaged = image;
+		std::memcpy(damaged.data() + offset, &value, sizeof(value));
+		const std::string path = scratchPath("test_damaged.axc");
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(damaged.data(), std::streamsize(damaged.size()));
+		ProductsList products;
+		size_t count = ProductsLoader::loadProductImage(path, products, verifyChecksum);
+		ProductsPricer pricer(path, verifyChecksum);
+		std::remove(path.c_str());
+		return count == pricer.getProductsCount() ? count : NOT_FOUND;
+	};
+	const char renamed = '#';
+	const double importance = 2.0;
+	const ProductIndex forwardInput = ProductIndex(generated.size() - 1);
+	bool damaged = loadDamaged(stringsOffset, renamed, false) == generated.size()         // name byte, checksum only
+		&& loadDamaged(stringsOffset, renamed, true) == 0
+		&& loadDamaged(productsOffset + 72, importance, false) == 0                         // importance of the first record
+		&& loadDamaged(inputsOffset + (materialsCount - 1) * sizeof(ProductIndex), forwardInput, false) == 0;
+	std::remove(imagePath.c_str());
+	std::remove(jsonPath.c_str());
+	cout << "Damaged images rejected by range checks and optional checksum " << (damaged ? "PASSED" : "FAILED") << endl;
+	return passed && damaged;
+}
+
+
+bool callAuctionTest() {
+
+	// Chairs market: bids 10@105, 10@100, 10@100 against asks 5@90, 10@98, 10@100, 10@100
+	// clear at 100 for 30 chairs, two asks of the marginal level are filled pro rata by 7.5
+	MarketEngine engine("data/products.json");
+	const ProductID chair = 2;
+	std::vector<AgentID> households, firms;
+	for (int i = 0; i < 3; i++) households.push_back(engine.addAgent(Household{}));
+	for (int i = 0; i < 4; i++) firms.push_back(engine.addAgent(Firm{}));
+	const double bids[] = { 105, 100, 100 };
+	const double asks[][2] = { { 5, 90 }, { 10, 98 }, { 10, 100 }, { 10, 100 } };
+	for (int i = 0; i < 3; i++) engine.submitOrder(households[i], chair, 10, Money(bids[i]), OrderSide::Buy);
+	for (int i = 0; i < 4; i++) engine.submitOrder(firms[i], chair, asks[i][0], Money(asks[i][1]), OrderSide::Sell);
+
+	// Orders with NaN, infinite or non-positive limit price never reach the auction sort and aggregates
+	const double invalidPrices[] = { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(), 0, -100 };
+	bool rejected = true;
+	for (double invalid : invalidPrices) {
+		rejected = rejected && !engine.submitOrder(households[0], chair, 10, Money(invalid), OrderSide::Buy);
+		rejected = rejected && !engine.submitOrder(firms[0], chair, 10, Money(invalid), OrderSide::Sell);
+	}
+	engine.processTick();
+
+	const double expectedCash[] = { -1000, -1000, -1000, 500, 1000, 750, 750 };
+	const double expectedChairs[] = { 10, 10, 10, -5, -10, -7.5, -7.5 };
+	bool passed = rejected && engine.getPriceHistory().getVolume(ProductIndex(2)) == 30;
+	passed = passed && engine.getPriceHistory().getDemand(ProductIndex(2)) == 30 && engine.getPriceHistory().getSupply(ProductIndex(2)) == 35;
+	for (AgentID agent = 0; agent < engine.getAgentsCount(); agent++) {
+		double cash = double(engine.getAgent(agent).getCash());
+		double chairs = engine.getAgent(agent).getQuantity(chair);
+		passed = passed && std::abs(cash - expectedCash[agent]) < 1e-9 && std::abs(chairs - expectedChairs[agent]) < 1e-9;
+		cout << "Agent " << agent << " cash " << cash << " chairs " << chairs << endl;
+	}
+	cout << "Call auction cleared " << engine.getPriceHistory().getVolume(ProductIndex(2)) << " chairs"
+		<< (passed ? " PASSED" : " FAILED") << endl;
+
+	// Price ladder of one firm submitted as a batch, empty quote is skipped
+	const Quote ladder[] = { { 5, Money(90) }, { 0, Money(95) }, { 10, Money(98) } };
+	bool accepted = engine.submitOrders(firms[0], chair, OrderSide::Sell, ladder) == 2;
+	accepted = accepted && engine.submitOrders(firms[0], 99, OrderSide::Sell, ladder) == 0;
+	engine.submitOrder(households[0], chair, 20, Money(99), OrderSide::Buy);
+	engine.processTick();
+	const PriceHistory& history = engine.getPriceHistory();
+	accepted = accepted && history.getSupply(ProductIndex(2)) == 15 && history.getDemand(ProductIndex(2)) == 20;
+	accepted = accepted && history.getVolume(ProductIndex(2)) == 15 && engine.getAgent(firms[0]).getQuantity(chair) == -20;
+	cout << "Batch submission " << (accepted ? "PASSED" : "FAILED") << endl;
+	return passed && accepted;
+}
+
+
+bool limitOrderBookTest(size_t ordersCount) {
+
+	// Chairs market in continuous mode: price-time priority, partial fills and cancel
+	MarketEngine engine("data/products.json");
+	engine.setClearingMode(ClearingMode::Continuous);
+	const ProductID chair = 2;
+	for (int i = 0; i < 2; i++) engine.addAgent(Household{});
+	for (int i = 0; i < 2; i++) engine.addAgent(Firm{});
+	OrderHandle handle;
+	engine.submitOrder(2, chair, 10, Money(100), OrderSide::Sell);
+	engine.submitOrder(3, chair, 5, Money(100), OrderSide::Sell);
+	engine.submitOrder(2, chair, 10, Money(105), OrderSide::Sell, handle);
+	engine.submitOrder(0, chair, 12, Money(102), OrderSide::Buy);          // 10 from agent 2, then 2 from agent 3
+	bool passed = engine.cancelOrder(handle) && !engine.cancelOrder(handle);
+	const LimitOrderBook& book = engine.getLimitOrderBook();
+	passed = passed && book.getBestPrice(2, OrderSide::Sell) == Money(100) && book.getBestQuantity(2, OrderSide::Sell) == 3;
+	engine.submitOrder(1, chair, 5, Money(110), OrderSide::Buy, handle);   // 3 from agent 3, 2 rest
+	passed = passed && book.getRestingQuantity(handle) == 2 && book.getBestPrice(2, OrderSide::Buy) == Money(110);
+	passed = passed && book.getLevelsCount(2, OrderSide::Sell) == 0 && book.getOrdersCount() == 1;
+	engine.processTick();
+	const double expectedCash[] = { -1200, -300, 1000, 500 };
+	const double expectedChairs[] = { 12, 3, -10, -5 };
+	for (AgentID agent = 0; agent < engine.getAgentsCount(); agent++) {
+		passed = passed && double(engine.getAgent(agent).getCash()) == expectedCash[agent]
+			&& engine.getAgent(agent).getQuantity(chair) == expectedChairs[agent];
+	}
+	passed = passed && engine.getPriceHistory().getVolume(2) == 15;
+	cout << "Limit order book matching " << (passed ? "PASSED" : "FAILED") << endl;
+
+	// Orders with NaN, infinite, zero or negative limit price or quantity never reach the book
+	const double nan = std::numeric_limits<double>::quiet_NaN(), infinity = std::numeric_limits<double>::infinity();
+	const double invalidPrices[] = { nan, infinity, -infinity, 0, -100 };
+	bool rejected = true;
+	for (double invalid : invalidPrices) {
+		for (OrderSide side : { OrderSide::Buy, OrderSide::Sell }) {
+			rejected = rejected && !engine.submitOrder(0, chair, 1, Money(invalid), side, handle) && handle == NO_ORDER;
+			rejected = rejected && !engine.submitOrder(0, chair, invalid, Money(100), side);
+			Quote quote{ 1, Money(invalid) };
+			rejected = rejected && engine.submitOrders(0, chair, side, std::span<const Quote>(&quote, 1)) == 0;
+		}
+	}
+	engine.submitOrder(1, chair, 2, Money(90), OrderSide::Buy, handle);
+	OrderHandle amended = handle;
+	rejected = rejected && !engine.amendOrder(amended, 2, Money(nan)) && !engine.amendOrder(amended, infinity, Money(90));
+	rejected = rejected && book.getOrdersCount() == 2 && book.getLevelsCount(2, OrderSide::Buy) == 2 && book.getLevelsCount(2, OrderSide::Sell) == 0;
+	rejected = rejected && engine.cancelOrder(handle) && book.getBestPrice(2, OrderSide::Buy) == Money(110);
+	cout << "Limit order book rejects invalid limits " << (rejected ? "PASSED" : "FAILED") << endl;
+	passed = passed && rejected;
+
+	// Random order flow around the market price, every third resting order is cancelled
+	std::mt19937_64 random(2025);
+	std::normal_distribution<double> price(100, 2);
+	std::uniform_real_distribution<double> quantity(1, 10);
+	std::vector<OrderHandle> resting;
+	size_t cancelled = 0;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t i = 0; i < ordersCount; i++) {
+		OrderSide side = (random() & 1) ? OrderSide::Buy : OrderSide::Sell;
+		engine.submitOrder(AgentID(random() & 3), chair, std::round(quantity(random)), Money(std::round(price(random) * 10) / 10), side, handle);
+		if (handle != NO_ORDER) resting.push_back(handle);
+		if (i % 3 == 2 && !resting.empty()) {
+			size_t victim = random() % resting.size();
+			cancelled += engine.cancelOrder(resting[victim]);
+			resting[victim] = resting.back();
+			resting.pop_back();
+		}
+	}
+	std::chrono::duration<double, std::nano> elapsed = std::chrono::high_resolution_clock::now() - start;
+	cout << ordersCount << " orders, " << cancelled << " cancelled, " << book.getOrdersCount() << " resting, "
+		<< elapsed.count() / double(ordersCount) << " ns per order" << endl;
+	return passed;
+}
+
+
+bool standingOrdersTest(size_t ordersCount, size_t ticks) {
+
+	// Chairs call auction with good-till-cancelled orders living across ticks
+	MarketEngine engine("data/products.json");
+	const ProductID chair = 2;
+	const ProductIndex index = ProductIndex(2);
+	for (int i = 0; i < 2; i++) engine.addAgent(Household{});
+	for (int i = 0; i < 2; i++) engine.addAgent(Firm{});
+	const LimitOrderBook& book = engine.getLimitOrderBook();
+	OrderHandle bid, ask, farAsk;
+	engine.submitOrder(0, chair, 10, Money(100), OrderSide::Buy, bid);
+	engine.submitOrder(2, chair, 4, Money(95), OrderSide::Sell, ask);
+	engine.submitOrder(3, chair, 10, Money(120), OrderSide::Sell, farAsk);
+	engine.processTick();                                                  // 4 chairs trade, bid keeps 6
+	const PriceHistory& history = engine.getPriceHistory();
+	bool passed = history.getDemand(index) == 10 && history.getSupply(index) == 14 && history.getVolume(index) == 4;
+	passed = passed && book.getRestingQuantity(bid) == 6 && book.getOrder(ask) == nullptr;
+	passed = passed && book.getOpenQuantity(index, OrderSide::Buy) == 6 && book.getOpenQuantity(index, OrderSide::Sell) == 10;
+
+	OrderHandle amended = bid;
+	passed = passed && engine.amendOrder(amended, 5, Money(100)) && amended == bid;   // reduce keeps priority
+	passed = passed && engine.amendOrder(farAsk, 8, Money(99));                      // price change replaces
+	engine.submitOrder(1, chair, 2, Money(101), OrderSide::Buy);                     // order of one tick
+	engine.processTick();                                                  // 7 chairs trade, 1 left of the ask
+	passed = passed && history.getVolume(index) == 7 && book.getOrder(bid) == nullptr && book.getRestingQuantity(farAsk) == 1;
+	passed = passed && engine.cancelOrder(farAsk) && !engine.cancelOrder(farAsk) && book.getOrdersCount() == 0;
+	passed = passed && book.getOpenQuantity(index, OrderSide::Buy) == 0 && book.getOpenQuantity(index, OrderSide::Sell) == 0;
+	double cash = 0;
+	for (AgentID agent = 0; agent < engine.getAgentsCount(); agent++) cash += double(engine.getAgent(agent).getCash());
+	const double expectedChairs[] = { 9, 2, -4, -7 };
+	for (AgentID agent = 0; agent < engine.getAgentsCount(); agent++) {
+		passed = passed && engine.getAgent(agent).getQuantity(chair) == expectedChairs[agent];
+	}
+	passed = passed && std::abs(cash) < 1e-9;
+	cout << "Good-till-cancelled orders " << (passed ? "PASSED" : "FAILED") << endl;
+
+	// Deep books far from the market: per tick work follows order churn, not open orders
+	std::mt19937_64 random(2025);
+	std::uniform_int_distribution<int> cents(100, 4000);
+	auto depth = [&cents](std::mt19937_64& random) { return cents(random) / 100.0; };
+	std::vector<OrderHandle> handles(ordersCount);
+	for (size_t i = 0; i < ordersCount; i++) {
+		bool buy = i % 2 == 0;
+		engine.submitOrder(AgentID(i % 4), chair, 1, Money(buy ? 100 - depth(random) : 110 + depth(random)),
+			buy ? OrderSide::Buy : OrderSide::Sell, handles[i]);
+	}
+	auto start = std::chrono::high_resolution_clock::now();
+	for (size_t tick = 0; tick < ticks; tick++) {
+		for (int i = 0; i < 10; i++) {
+			OrderHandle& handle = handles[random() % ordersCount];
+			if (book.getOrder(handle) != nullptr) engine.amendOrder(handle, 2, book.getOrder(handle)->price);
+		}
+		engine.submitOrder(0, chair, 1, Money(105), OrderSide::Buy);
+		engine.submitOrder(2, chair, 1, Money(105), OrderSide::Sell);
+		engine.processTick();
+	}
+	std::chrono::duration<double, std::milli> standing = std::chrono::high_resolution_clock::now() - start;
+
+	// Same books resubmitted every tick as orders of one tick
+	for (OrderHandle handle : handles) engine.cancelOrder(handle);
+	size_t resubmittedTicks = std::max<size_t>(ticks / 10, 1);
+	start = std::chrono::high_resolution_clock::now();
+	for (size_t tick = 0; tick < resubmittedTicks; tick++) {
+		for (size_t i = 0; i < ordersCount; i++) {
+			bool buy = i % 2 == 0;
+			engine.submitOrder(AgentID(i % 4), chair, 1, Money(buy ? 100 - depth(random) : 110 + depth(random)),
+				buy ? OrderSide::Buy : OrderSide::Sell);
+		}
+		engine.processTick();
+	}
+	std::chrono::duration<double, std::milli> resubmitted = std::chrono::high_resolution_clock::now() - start;
+	cout << ordersCount << " open orders: " << standing.count() / double(ticks) << " ms per tick resting, "
+		<< resubmitted.count() / double(resubmittedTicks) << " ms per tick resubmitted" << endl;
+	return passed;
+}
+
+
+bool catalogReloadTest() {
+
+	// Reloaded catalog drops 2, adds 7 and 6 in front of the retained products, changes importance of 3 and inputs of 4
+	ProductsList original = { makeProduct(1), makeProduct(2), makeProduct(3, { 1 }), makeProduct(4, { 2 }), makeProduct(5, { 3, 4 }) };
+	ProductsList modified = { makeProduct(7), makeProduct(6), makeProduct(1), makeProduct(3, { 1 }), makeProduct(4, { 6 }), makeProduct(5, { 3, 4 }) };
+	modified[3].importance = 0.9;
+	const std::string originalPath = scratchPath("test_reload_original.json");
+	const std::string modifiedPath = scratchPath("test_reload_modified.json");
+	bool saved = ProductsLoader::saveProductList(originalPath, original) && ProductsLoader::saveProductList(modifiedPath, modified);
+
+	// Pricer reports the diff and the remap, retained products keep prices moved by the market
+	ProductsPricer pricer(originalPath), reloadedPricer(modifiedPath);
+	for (size_t tick = 0; tick < 3; tick++) {
+		for (size_t index = 0; index < pricer.getProductsCount(); index++) pricer.setMarketData(index, 150 + 10 * index, 100);
+		pricer.evaluatePrices();
+	}
+	std::vector<Money> prices;
+	for (const Product& product : original) prices.push_back(pricer.getProductPrice(product.productID));
+	std::vector<size_t> expectedRemap;
+	for (size_t index = 0; index < original.size(); index++) {
+		ProductID productID = pricer.getProductID(index);
+		expectedRemap.push_back(productID == 2 ? NOT_FOUND : reloadedPricer.getIndexByProductID(productID));
+	}
+	ProductsDiff diff;
+	bool passed = saved && pricer.reloadProducts(modifiedPath, diff) && pricer.getProductsCount() == modified.size();
+	passed = passed && diff.added == std::vector<ProductID>{ 7, 6 } && diff.removed == std::vector<ProductID>{ 2 }
+		&& diff.changed == std::vector<ProductID>{ 3, 4 } && diff.remap == expectedRemap;
+	for (size_t i = 0; i < original.size(); i++) {
+		ProductID productID = original[i].productID;
+		passed = passed && (productID == 2 || (pricer.getProductPrice(productID) == prices[i] && prices[i] != Money(10)));
+	}
+	passed = passed && pricer.getProductPrice(7) == Money(10) && pricer.getProductPrice(6) == Money(10);
+	cout << "Catalog reload diff, remap and retained prices " << (passed ? "PASSED" : "FAILED") << endl;
+
+	// Running continuous market with history, resting good-till-cancelled orders and trades of the current tick
+	MarketEngine engine(originalPath);
+	engine.setClearingMode(ClearingMode::Continuous);
+	for (int i = 0; i < 2; i++) engine.addAgent(Household{});
+	for (int i = 0; i < 2; i++) engine.addAgent(Firm{});
+	for (size_t tick = 0; tick < 4; tick++) {
+		engine.submitOrder(0, 5, 2 + tick, Money(12), OrderSide::Buy);
+		engine.submitOrder(2, 5, 2 + tick, Money(11), OrderSide::Sell);
+		engine.processTick();
+	}
+	OrderHandle removedBid, bid, ask;
+	engine.submitOrder(1, 2, 4, Money(5), OrderSide::Buy, removedBid);
+	engine.submitOrder(1, 4, 6, Money(5), OrderSide::Buy, bid);
+	engine.submitOrder(3, 5, 8, Money(1000), OrderSide::Sell, ask);
+	engine.submitOrder(0, 1, 3, Money(11), OrderSide::Buy);
+	engine.submitOrder(2, 1, 3, Money(9), OrderSide::Sell);                       // trades 3 of product 1 in this tick
+	const PriceHistory& history = engine.getPriceHistory();
+	struct HistoryRow { Price price; Quantity demand; Quantity volume; };
+	std::vector<std::vector<HistoryRow>> rows(original.size());
+	for (size_t index = 0; index < original.size(); index++) {
+		for (size_t lag = 0; lag < history.getDepth(); lag++) {
+			ProductIndex product = ProductIndex(index);
+			rows[index].push_back({ history.getPrice(product, lag), history.getDemand(product, lag), history.getVolume(product, lag) });
+		}
+	}
+	size_t ticksCount = history.getTicksCount();
+
+	// Books, orders, aggregates of the tick and history follow the retained products to their new indices
+	ProductsDiff engineDiff;
+	bool remapped = engine.reloadProducts(modifiedPath, engineDiff) && engineDiff.remap == expectedRemap;
+	const LimitOrderBook& book = engine.getLimitOrderBook();
+	const ProductIndex product1 = ProductIndex(expectedRemap[0]), product4 = ProductIndex(expectedRemap[3]), product5 = ProductIndex(expectedRemap[4]);
+	remapped = remapped && book.getOrder(removedBid) == nullptr && book.getOrdersCount() == 2;
+	remapped = remapped && book.getOrder(bid) != nullptr && book.getOrder(bid)->product == product4 && book.getRestingQuantity(bid) == 6;
+	remapped = remapped && book.getOrder(ask) != nullptr && book.getOrder(ask)->product == product5 && book.getRestingQuantity(ask) == 8;
+	remapped = remapped && book.getOpenQuantity(product4, OrderSide::Buy) == 6 && book.getOpenQuantity(product5, OrderSide::Sell) == 8;
+	remapped = remapped && history.getTicksCount() == ticksCount;
+	for (size_t oldIndex = 0; oldIndex < original.size(); oldIndex++) {
+		if (expectedRemap[oldIndex] == NOT_FOUND) continue;
+		ProductIndex product = ProductIndex(expectedRemap[oldIndex]);
+		for (size_t lag = 0; lag < rows[oldIndex].size(); lag++) {
+			const HistoryRow& row = rows[oldIndex][lag];
+			remapped = remapped && history.getPrice(product, lag) == row.price
+				&& history.getDemand(product, lag) == row.demand && history.getVolume(product, lag) == row.volume;
+		}
+	}
+	engine.processTick();
+	remapped = remapped && history.getVolume(product1) == 3 && history.getDemand(product1) == 3;
+	remapped = remapped && history.getDemand(product4) == 6 && history.getSupply(product5) == 8;
+	remapped = remapped && engine.cancelOrder(bid) && engine.cancelOrder(ask) && book.getOrdersCount() == 0;
+	std::remove(originalPath.c_str());
+	std::remove(modifiedPath.c_str());
+	cout << "Catalog reload remaps books, orders, aggregates and history " << (remapped ? "PASSED" : "FAILED") << endl;
+	return passed && remapped;
+}
+
+
 void marketTester() {
-	MarketEngine me("data\\products.json");
+	MarketEngine me("data/products.json");
 	me.processTick();
 }
 
 
-int main()
+int main(int argc, char* argv[])
 {	
+	std::string command = argc > 1 ? argv[1] : "";
+	if (command == "bench-loader") {
+		productLoaderBenchmark(argc > 2 ? std::stoull(argv[2]) : 10000);
+		return 0;
+	}
+	if (command == "bench-pricer") {
+		productPricerBenchmark(argc > 2 ? std::stoull(argv[2]) : 100000, argc > 3 ? std::stoull(argv[3]) : 20,
+			argc > 4 ? std::stoull(argv[4]) : 0);
+		return 0;
+	}
+	if (command == "bench-clearing") {
+		marketClearingBenchmark(argc > 2 ? std::stoull(argv[2]) : 10000, argc > 3 ? std::stoull(argv[3]) : 1000000,
+			argc > 4 ? std::stoull(argv[4]) : 5, argc > 5 ? std::stoull(argv[5]) : 0);
+		return 0;
+	}
+	if (command == "bench-agents") {
+		agentPoolsBenchmark(argc > 2 ? std::stoull(argv[2]) : 1000000, argc > 3 ? std::stoull(argv[3]) : 100000,
+			argc > 4 ? std::stoull(argv[4]) : 20);
+		return 0;
+	}
+	if (command == "test-agents") {
+		return agentsPopulationTest() ? 0 : 1;
+	}
+	if (command == "test-incremental") {
+		return incrementalPricingTest(argc > 2 ? std::stoull(argv[2]) : 100000, argc > 3 ? std::stoull(argv[3]) : 100,
+			argc > 4 ? std::stod(argv[4]) : 1e-9) ? 0 : 1;
+	}
+	if (command == "test-fast-forward") {
+		return fastForwardTest(argc > 2 ? std::stoull(argv[2]) : 100000, argc > 3 ? std::stoull(argv[3]) : 100) ? 0 : 1;
+	}
+	if (command == "test-history") {
+		return priceHistoryTest() ? 0 : 1;
+	}
+	if (command == "test-money") {
+		return moneyTest() ? 0 : 1;
+	}
+	if (command == "test-levels") {
+		return parallelPricingTest(argc > 2 ? std::stoull(argv[2]) : 4) ? 0 : 1;
+	}
+	if (command == "test-auction") {
+		return callAuctionTest() ? 0 : 1;
+	}
+	if (command == "test-lob") {
+		return limitOrderBookTest(argc > 2 ? std::stoull(argv[2]) : 1000000) ? 0 : 1;
+	}
+	if (command == "test-gtc") {
+		return standingOrdersTest(argc > 2 ? std::stoull(argv[2]) : 200000, argc > 3 ? std::stoull(argv[3]) : 100) ? 0 : 1;
+	}
+	if (command == "test-clearing") {
+		return parallelClearingTest(argc > 2 ? std::stoull(argv[2]) : 4) ? 0 : 1;
+	}
+	if (command == "test-budget") {
+		return constrainedAuctionTest(argc > 2 ? std::stoull(argv[2]) : 4) ? 0 : 1;
+	}
+	if (command == "test-kernels") {
+		return pricingKernelsTest() ? 0 : 1;
+	}
+	if (command == "compile" && argc > 3) {
+		ProductsList products;
+		bool compiled = ProductsLoader::loadProductList(argv[2], products) > 0
+			&& ProductsLoader::saveProductImage(argv[3], products);
+		if (!compiled) cerr << "Failed to compile " << argv[2] << " to " << argv[3] << endl;
+		return compiled ? 0 : 1;
+	}
+	if (command == "decompile" && argc > 3) {
+		ProductsList products;
+		bool decompiled = ProductsLoader::loadProductImage(argv[2], products, true) > 0
+			&& ProductsLoader::saveProductList(argv[3], products);
+		if (!decompiled) cerr << "Failed to decompile " << argv[2] << " to " << argv[3] << endl;
+		return decompiled ? 0 : 1;
+	}
+	if (command == "test-loader") {
+		return productListTest() ? 0 : 1;
+	}
+	if (command == "test-linker") {
+		return catalogLinkerTest() ? 0 : 1;
+	}
+	if (command == "test-shards") {
+		return catalogShardsTest() ? 0 : 1;
+	}
+	if (command == "test-reload") {
+		return catalogReloadTest() ? 0 : 1;
+	}
+	if (command == "test-image") {
+		bool roundTrip = productImageTest(argc > 2 ? argv[2] : "data/products.json");
+		bool linked = linkedImageTest();
+		return roundTrip && linked ? 0 : 1;
+	}
 	//	productLoaderTest();
 	marketTester();
 	return 0;
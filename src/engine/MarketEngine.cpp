@@ -1,17 +1,58 @@
 ﻿
 #include "MarketEngine.h"
 
+#include <limits>
 #include <unordered_set>
 
 
 using namespace Axionomy;
 
 
-MarketEngine::MarketEngine(const std::string& productsList) : productsPricer(productsList) {
+namespace {
+
+    // Smallest money amount of reservations, the fixed-point money unit
+    constexpr double MONEY_UNITS = double(FixedMoney<AXIONOMY_MONEY_DECIMALS>::scale);
+
+    // Relative share of cash kept out of reservations for rounding of trade values
+    constexpr double BUDGET_MARGIN = 1e-9;
+
+    // Reservation totals saturate at the largest money units count instead of overflowing
+    constexpr int64_t MAX_RESERVATION = std::numeric_limits<int64_t>::max();
+
+    // Worst case spending of a bid in money units, clamped before the integer conversion
+    int64_t reservationUnits(const Order& order) {
+        double units = std::ceil(double(order.price) * order.quantity * MONEY_UNITS);
+        return units < double(MAX_RESERVATION) ? int64_t(units) : MAX_RESERVATION;
+    }
+
+    // Saturating add of non-negative units, the saturated total does not depend on addition order
+    void reserveUnits(std::atomic<int64_t>& total, int64_t units) {
+        int64_t current = total.load(std::memory_order_relaxed);
+        while (!total.compare_exchange_weak(current, current > MAX_RESERVATION - units ? MAX_RESERVATION : current + units,
+            std::memory_order_relaxed)) {}
+    }
+
+    // Orders must have finite positive quantity and limit price: books and auctions order them by
+    // price, and NaN breaks the ordering of price levels and of the auction sort
+    bool validLimits(Quantity qty, Money limitPrice) {
+        return std::isfinite(qty) && qty > 0 && std::isfinite(double(limitPrice)) && limitPrice > Money(0);
+    }
+
+}
+
+
+MarketEngine::MarketEngine(const std::string& productsList, size_t historyCapacity) :
+    productsPricer(productsList), priceHistory(historyCapacity) {
     tickCounter = 0;
-    size_t productsCount = productsPricer.getProductsList().size();
-    aggregateDemand.reserve(productsCount);
-    aggregateSupply.reserve(productsCount);
+    threadPool = std::make_unique<ThreadPool>();
+    pool = threadPool.get();
+    productsPricer.setThreadPool(pool);
+    size_t productsCount = productsPricer.getProductsCount();
+    aggregateDemand.assign(productsCount, 0);
+    aggregateSupply.assign(productsCount, 0);
+    clearedVolume.assign(productsCount, 0);
+    limitOrderBook.reset(productsCount);
+    priceHistory.reset(productsCount);
 }
 
 
@@ -23,7 +64,94 @@ void MarketEngine::processTick() {
     aggregateSupplyDemand();
     computeEquilibriumPrice();
     processMarketClearing();    
+    priceHistory.record(productsPricer.getProductsState(), clearedVolume.data());
     tickCounter++;
+
+    // Orders of one tick expire, good-till-cancelled orders stay in the books
+    for (OrderHandle handle : tickOrders) limitOrderBook.cancel(handle);
+    tickOrders.clear();
+
+    // Start orders and aggregates of the next tick, buffers keep their capacity
+    submittedOrders.clear();
+    std::fill(aggregateDemand.begin(), aggregateDemand.end(), 0);
+    std::fill(aggregateSupply.begin(), aggregateSupply.end(), 0);
+    std::fill(clearedVolume.begin(), clearedVolume.end(), 0);
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Last ticks of market data, shared read-only by agents and client API
+//----------------------------------------------------------------------------------------------------
+const PriceHistory& MarketEngine::getPriceHistory() const {
+    return priceHistory;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Skip idle ticks: agents do not act, prices relax under the demand and supply of the last tick,
+// skipped ticks are not recorded to price history
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::fastForward(size_t ticks) {
+    productsPricer.fastForward(ticks);
+    tickCounter += ticks;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Select multipliers math: full precision for player-facing sessions, float for background simulations
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::setPricingPrecision(PricingPrecision precision) {
+    productsPricer.setPricingPrecision(precision);
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Share external thread pool for pricing and clearing, nullptr returns to the engine's own pool.
+// Pools are switched between ticks only: a shared pool stops the own workers, returning to the own
+// pool starts them again, so no tick pays for starting threads
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::setThreadPool(ThreadPool* threadPool) {
+    if (threadPool != nullptr) {
+        pool = threadPool;
+        this->threadPool.reset();
+    } else {
+        if (this->threadPool == nullptr) this->threadPool = std::make_unique<ThreadPool>();
+        pool = this->threadPool.get();
+    }
+    productsPricer.setThreadPool(pool);
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Apply new products catalog between ticks keeping market state of unchanged products
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::reloadProducts(const std::string& productsList, ProductsDiff& diff) {
+    if (!productsPricer.reloadProducts(productsList, diff)) return false;
+
+    // Dense indices changed: move orders and aggregates of the tick, drop removed products
+    size_t productsCount = productsPricer.getProductsCount();
+    auto remap = [&diff, productsCount](auto& byProduct) {
+        std::remove_reference_t<decltype(byProduct)> remapped(productsCount);
+        for (size_t oldIndex = 0; oldIndex < diff.remap.size() && oldIndex < byProduct.size(); oldIndex++) {
+            if (diff.remap[oldIndex] != NOT_FOUND) remapped[diff.remap[oldIndex]] = std::move(byProduct[oldIndex]);
+        }
+        byProduct = std::move(remapped);
+    };
+    remap(aggregateDemand);
+    remap(aggregateSupply);
+    remap(clearedVolume);
+    std::erase_if(submittedOrders, [&diff](Order& order) {
+        size_t index = diff.remap[order.product];
+        order.product = ProductIndex(index);
+        return index == NOT_FOUND;
+    });
+    limitOrderBook.remap(diff, productsCount);
+    priceHistory.remap(diff, productsPricer.getProductsState());
+    return true;
 }
 
 
@@ -32,97 +160,609 @@ void MarketEngine::processTick() {
 // Process agents next step
 //----------------------------------------------------------------------------------------------------
 void MarketEngine::updateAgentsState() {
-    for (EconomicAgent& agent : agents) {
-        // provide market context
-        agent.tick();
-    }
+    // provide market context, agents submit orders directly to the engine
+    households.tick(*this);
+    firms.tick(*this);
 }
 
+
 //----------------------------------------------------------------------------------------------------
-// Copy all orders from agents to market orders book and calculate aggregates
+// Partition orders of the tick by product with a counting sort, so clearing reads every product
+// orders as one contiguous range of the orders book:
+// 1. Histogram pass counts orders and sums demand, supply and best prices by product
+// 2. Products whose best bid is below best ask cannot trade and get empty ranges, resting
+//    good-till-cancelled orders join the auction only if they cross the best opposite price,
+//    their copies are appended to the tick orders and counted
+// 3. Prefix sums of counts are product offsets, scatter pass writes orders to their product ranges
+//    keeping arrival order within product
 //----------------------------------------------------------------------------------------------------
 void MarketEngine::aggregateSupplyDemand() {
 
-    // Clear aggregates
-    for (auto& [productID, orders] : ordersBook) orders.clear();
-    for (auto& [productID, demandVolume] : aggregateDemand) demandVolume = 0;
-    for (auto& [productID, supplyVolume] : aggregateSupply) supplyVolume = 0;
-
-    // Compute demand/supply aggregates and make Product order books
-    for (const EconomicAgent& agent : agents) {
-        
-        // Aggregate all bid orders by products
-        for (const Order& bid : agent.buyOrders)                     // Iterate over all agents bid orders
-        if (bid.quantity > 0) {                                 // Discard zero or negative quantities
-            aggregateDemand[bid.productID] += bid.quantity;     // Compute demand aggregate
-            auto& productOrderBook = ordersBook[bid.productID]; // Get product Orders Book
-            productOrderBook.push_back(bid);                    // Copy bid order to Orders Book
+    size_t productsCount = productsPricer.getProductsCount();
+    ordersOffsets.assign(productsCount + 1, 0);
+    bidsCount.assign(productsCount, 0);
+    highestBid.resize(productsCount);
+    lowestAsk.resize(productsCount);
+
+    // 1. Histogram and aggregates, orders memory is read sequentially
+    for (const Order& order : submittedOrders) {
+        size_t product = order.product;
+        if (order.side == OrderSide::Buy) {
+            highestBid[product] = bidsCount[product] > 0 ? std::max(highestBid[product], order.price) : order.price;
+            aggregateDemand[product] += order.quantity;
+            bidsCount[product]++;
+        } else {
+            size_t asksCount = ordersOffsets[product + 1] - bidsCount[product];
+            lowestAsk[product] = asksCount > 0 ? std::min(lowestAsk[product], order.price) : order.price;
+            aggregateSupply[product] += order.quantity;
         }
-        
-        // Aggregate all ask orders by products
-        for (const Order& ask : agent.sellOrders)                     // Iterate over all agents ask orders
-        if (ask.quantity > 0) {                                 // Discard zero or negative quantities 
-            aggregateSupply[ask.productID] += ask.quantity;     // Compute supply aggregate 
-            auto& productOrderBook = ordersBook[ask.productID]; // Get product Ask Orders Book
-            productOrderBook.push_back(ask);                    // Copy ask order to Ask Orders Book
+        ordersOffsets[product + 1]++;
+    }
+
+    // Continuous mode orders were matched on arrival, its books never cross
+    if (clearingMode == ClearingMode::Continuous) {
+        std::fill(ordersOffsets.begin(), ordersOffsets.end(), 0);
+        ordersBook.clear();
+        return;
+    }
+
+    // 2. Crossing products and resting orders, bids count becomes NOT_FOUND for products that cannot trade
+    bool hasResting = limitOrderBook.getOrdersCount() > 0;
+    for (ProductIndex product = 0; product < productsCount; product++) {
+        size_t bids = bidsCount[product];
+        size_t asks = ordersOffsets[product + 1] - bids;
+        bool restingBids = hasResting && limitOrderBook.getLevelsCount(product, OrderSide::Buy) > 0;
+        bool restingAsks = hasResting && limitOrderBook.getLevelsCount(product, OrderSide::Sell) > 0;
+        Money bestBid = highestBid[product];
+        Money bestAsk = lowestAsk[product];
+        if (restingBids && (bids == 0 || limitOrderBook.getBestPrice(product, OrderSide::Buy) > bestBid)) bestBid = limitOrderBook.getBestPrice(product, OrderSide::Buy);
+        if (restingAsks && (asks == 0 || limitOrderBook.getBestPrice(product, OrderSide::Sell) < bestAsk)) bestAsk = limitOrderBook.getBestPrice(product, OrderSide::Sell);
+        if ((bids == 0 && !restingBids) || (asks == 0 && !restingAsks) || bestBid < bestAsk) {
+            bidsCount[product] = NOT_FOUND;
+            ordersOffsets[product + 1] = 0;
+            continue;
         }
+        size_t submitted = submittedOrders.size();
+        if (restingBids) limitOrderBook.collect(product, OrderSide::Buy, bestAsk, submittedOrders);
+        if (restingAsks) limitOrderBook.collect(product, OrderSide::Sell, bestBid, submittedOrders);
+        ordersOffsets[product + 1] += submittedOrders.size() - submitted;
+    }
 
+    // 3. Offsets and scatter, orders book is sized once, bids count is reused as write cursors
+    for (size_t product = 0; product < productsCount; product++) {
+        ordersOffsets[product + 1] += ordersOffsets[product];
+        if (bidsCount[product] != NOT_FOUND) bidsCount[product] = ordersOffsets[product];
+    }
+    ordersBook.resize(ordersOffsets[productsCount]);
+    for (const Order& order : submittedOrders) {
+        size_t& cursor = bidsCount[order.product];
+        if (cursor != NOT_FOUND) ordersBook[cursor++] = order;
     }
 
 }
 
 
 //----------------------------------------------------------------------------------------------------
-// Calculate equilibrium price for each product using aggegates in products pricer
+// Calculate equilibrium price for each product using aggegates in products pricer: orders of the tick
+// and open quantities of resting orders, which the order books keep up to date on every change
 //----------------------------------------------------------------------------------------------------
 void MarketEngine::computeEquilibriumPrice() {
 
-    const ProductsList& productsList = productsPricer.getProductsList();
+    size_t productsCount = productsPricer.getProductsCount();
 
-    for (const Product& product : productsList) {
-        Quantity totalDemand = aggregateDemand[product.productID];
-        Quantity totalSupply = aggregateSupply[product.productID];
-        productsPricer.computeEquilibriumPrice(product.productID, totalDemand, totalSupply);
+    for (ProductIndex index = 0; index < productsCount; index++) {
+        productsPricer.setMarketData(index,
+            aggregateDemand[index] + limitOrderBook.getOpenQuantity(index, OrderSide::Buy),
+            aggregateSupply[index] + limitOrderBook.getOpenQuantity(index, OrderSide::Sell));
     }
 
+    // Single pass over hot products state in topological order
+    productsPricer.evaluatePrices();
+
 }
 
 
 //----------------------------------------------------------------------------------------------------
-// Process market clearing
+// Process market clearing: products clear independently on the thread pool, largest books first so
+// the longest auctions do not start last. Every product writes trades to its own ledger slots,
+// settlement applies them by agent, results do not depend on threads count.
+// Constrained auction reserves agents cash before the auctions, see reserveBudgets.
 //----------------------------------------------------------------------------------------------------
 void MarketEngine::processMarketClearing() {
 
-    const ProductsList& productsList = productsPricer.getProductsList();
+    // Continuous mode orders were matched on arrival
+    if (clearingMode == ClearingMode::Continuous) return;
+
+    size_t productsCount = productsPricer.getProductsCount();
+
+    // Products with orders of the tick or crossing resting orders, by descending book size
+    clearingQueue.clear();
+    for (ProductIndex product = 0; product < productsCount; product++) {
+        if (ordersOffsets[product + 1] > ordersOffsets[product]) clearingQueue.push_back(product);
+    }
+    std::sort(clearingQueue.begin(), clearingQueue.end(), [this](ProductIndex a, ProductIndex b) {
+        size_t sizeA = ordersOffsets[a + 1] - ordersOffsets[a];
+        size_t sizeB = ordersOffsets[b + 1] - ordersOffsets[b];
+        return sizeA != sizeB ? sizeA > sizeB : a < b;
+    });
+
+    // Pairing makes fewer trades than orders, so trade slots of a product are its orders range
+    tickTrades.resize(ordersBook.size());
+    tradesCount.assign(productsCount, 0);
+    if (clearingMode == ClearingMode::ConstrainedAuction) reserveBudgets();
+    pool->parallelFor(clearingQueue.size(), [this](size_t index, size_t) {
+        processProductClearing(clearingQueue[index]);
+    });
+
+    settleTrades();
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Pessimistic cash reservation of the constrained auction, in parallel over products:
+// 1. Every bid reserves its worst case spending, quantity at limit price, with an atomic add to
+//    its agent total before any auction runs. Totals are integer money units, so they do not depend
+//    on threads timing, and saturate instead of overflowing on huge quantities or prices.
+// 2. Agent requesting more than its cash gets the same affordable share of every bid, pro rata,
+//    whichever product and thread the bid cleared on. Agent with a saturated total gets no share,
+//    its request is beyond any cash that can be represented.
+// Clearing price never exceeds the limit price, so scaled bids never spend more than the cash, at
+// the cost of scaling bids that would have cleared below their limits within the cash.
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::reserveBudgets() {
+
+    size_t agentsCount = agents.size();
+    if (requestedCash.size() != agentsCount) requestedCash = std::vector<std::atomic<int64_t>>(agentsCount);
+    for (auto& requested : requestedCash) requested.store(0, std::memory_order_relaxed);
+
+    // 1. Reservations
+    pool->parallelFor(clearingQueue.size(), [this](size_t index, size_t) {
+        ProductIndex product = clearingQueue[index];
+        for (size_t i = ordersOffsets[product]; i < ordersOffsets[product + 1]; i++) {
+            const Order& order = ordersBook[i];
+            if (order.side != OrderSide::Buy || !(double(order.price) > 0)) continue;
+            reserveUnits(requestedCash[order.agent], reservationUnits(order));
+        }
+    });
+
+    // 2. Affordable shares
+    budgetScale.resize(agentsCount);
+    for (AgentID agent = 0; agent < agentsCount; agent++) {
+        int64_t requested = requestedCash[agent].load(std::memory_order_relaxed);
+        double available = std::floor(double(agentByID(agent).cash) * MONEY_UNITS * (1.0 - BUDGET_MARGIN));
+        if (requested == MAX_RESERVATION) budgetScale[agent] = 0.0;
+        else budgetScale[agent] = double(requested) <= available ? 1.0 : std::max(0.0, available / double(requested));
+    }
+
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Constrain product orders of the tick: bids are scaled by affordable shares of their agents, asks
+// of every agent are scaled to its inventory of the product. Orders left without quantity are moved
+// out of the auction span. Inventories are only read, trades are settled after all auctions.
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::applyBudgets(std::span<Order>& orders, ProductIndex product) {
+
+    auto asks = std::partition(orders.begin(), orders.end(), [](const Order& order) { return order.side == OrderSide::Buy; });
+    for (auto bid = orders.begin(); bid != asks; ++bid) bid->quantity *= budgetScale[bid->agent];
+
+    // Asks grouped by agent
+    ProductID productID = productsPricer.getProductID(product);
+    std::sort(asks, orders.end(), [](const Order& a, const Order& b) { return a.agent < b.agent; });
+    for (auto first = asks; first != orders.end();) {
+        auto last = std::find_if(first, orders.end(), [agent = first->agent](const Order& order) { return order.agent != agent; });
+        Quantity requested = 0;
+        for (auto ask = first; ask != last; ++ask) requested += ask->quantity;
+        Quantity available = std::max<Quantity>(agentByID(first->agent).getQuantity(productID), 0);
+        if (requested > available) {
+            double share = requested > 0 ? available / requested : 0.0;
+            for (auto ask = first; ask != last; ++ask) ask->quantity *= share;
+        }
+        first = last;
+    }
+
+    auto empty = std::partition(orders.begin(), orders.end(), [](const Order& order) { return order.quantity > 0; });
+    std::for_each(empty, orders.end(), [](Order& order) { order.quantity = 0; });
+    orders = orders.first(size_t(empty - orders.begin()));
+
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Constrained auction trades are capped by buyer cash and seller inventory in trade order, which only
+// trims rounding of reserved amounts, so balances never become negative. Buyers spend their cash of
+// the tick start and sellers sell their stock of the product, proceeds of the tick are not counted.
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::capTrades() {
+
+    size_t productsCount = productsPricer.getProductsCount();
+    size_t agentsCount = agents.size();
+    spendableCash.resize(agentsCount);
+    sellerStock.resize(agentsCount);
+    for (AgentID agent = 0; agent < agentsCount; agent++) spendableCash[agent] = agentByID(agent).cash;
+
+    size_t first = 0;
+    for (ProductIndex product = 0; product < productsCount; product++) {
+        size_t last = first + tradesCount[product];
+        ProductID productID = productsPricer.getProductID(product);
+        for (size_t i = first; i < last; i++) sellerStock[tickTrades.seller[i]] = agentByID(tickTrades.seller[i]).getQuantity(productID);
+        for (size_t i = first; i < last; i++) {
+            Quantity traded = tickTrades.quantity[i];
+            Money price = tickTrades.price[i];
+            Money& cash = spendableCash[tickTrades.buyer[i]];
+            Quantity& stock = sellerStock[tickTrades.seller[i]];
+            Quantity quantity = std::clamp(std::min(traded, stock), 0.0, traded);
+            if (price * quantity > cash) quantity = std::max(0.0, (double(cash) - 1.0 / MONEY_UNITS) / double(price));
+            if (price * quantity > cash) quantity = 0;
+            clearedVolume[product] -= traded - quantity;
+            tickTrades.quantity[i] = quantity;
+            cash -= price * quantity;
+            stock -= quantity;
+        }
+        first = last;
+    }
+
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Settle trades of the tick through the trade ledger and apply fills of resting orders to the books:
+// 1. Trade slots are compacted in product order, constrained auction caps trades in this order
+// 2. Postings are partitioned by agent, every agent applies its cash and inventory changes in one
+//    pass in trade order, so balances are the same as of trade by trade settlement. Agent ranges
+//    are independent and settle in parallel, results do not depend on threads count
+// 3. Resting orders are filled by settled trade quantities, orders that did not trade or whose
+//    trades were capped stay in the books with their unfilled quantity
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::settleTrades() {
+
+    size_t agentsCount = agents.size();
+
+    // 1. Trades in product order
+    tickTrades.compact(ordersOffsets, tradesCount);
+    bool traded = tickTrades.size() > 0;
+    if (traded && clearingMode == ClearingMode::ConstrainedAuction) capTrades();
 
-    // Iterate over all market products
-    for (const Product& product : productsList) {
-        // If product demand and supply is greater than zero then do the clearing
-        ProductID productID = product.productID;
-        if (aggregateDemand[productID] > 0 && aggregateSupply[productID] > 0) {
-            processProductClearing(productID);
+    // 2. Postings by agent, several agent ranges per worker balance uneven trading.
+    //    Partition is linear in agents count, ticks without trades skip it
+    size_t ranges = traded ? std::min(agentsCount, pool->getThreadsCount() * 8) : 0;
+    if (traded) tickTrades.partition(agentsCount);
+    pool->parallelFor(ranges, [this, agentsCount, ranges](size_t range, size_t) {
+        for (AgentID agent = agentsCount * range / ranges; agent < agentsCount * (range + 1) / ranges; agent++) {
+            EconomicAgent& account = agentByID(agent);
+            for (const TradeLedger::Posting& posting : tickTrades.getPostings(agent)) {
+                if (posting.quantity > 0) account.cash -= posting.value;
+                else account.cash += posting.value;
+                account.changeQuantity(productsPricer.getProductID(posting.product), posting.quantity);
+            }
         }
+    });
+
+    // 3. Fills of resting orders in trade order
+    for (size_t i = 0; i < tickTrades.size(); i++) {
+        if (!(tickTrades.quantity[i] > 0)) continue;
+        if (tickTrades.buyOrder[i] != NO_ORDER) limitOrderBook.fill(tickTrades.buyOrder[i], tickTrades.quantity[i]);
+        if (tickTrades.sellOrder[i] != NO_ORDER) limitOrderBook.fill(tickTrades.sellOrder[i], tickTrades.quantity[i]);
+    }
+
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Uniform price call auction clearing, in place on the product range of the orders book, which
+// holds orders of the tick and copies of crossing resting orders:
+// 1. Partition bids before asks, sort bids by descending and asks by ascending price, orders of
+//    one price level become adjacent (O(n log n), no allocations)
+// 2. Walk best bids against best asks while they cross, the last crossing bid and ask bound the
+//    uniform clearing price, the pricer's market price is taken if it is within the bounds
+// 3. Executed volume is min(demand at or above price, supply at or below price), the short side
+//    is filled completely, the long side is filled by price priority and pro rata at its marginal level
+// 4. Filled bids and asks are paired in order to trades at the clearing price, trades keep handles
+//    of resting orders, so settlement fills resting orders by the quantities actually settled
+// Runs on pool workers: writes only the product range, trade slots and cleared volume
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::processProductClearing(const ProductIndex product) {
+
+    std::span<Order> orders(ordersBook.data() + ordersOffsets[product], ordersOffsets[product + 1] - ordersOffsets[product]);
+    if (clearingMode == ClearingMode::ConstrainedAuction) applyBudgets(orders, product);
+
+    // 1. Price priority, agent ID breaks ties to keep pairing deterministic. Limits of every order
+    //    are validated at submission, finite prices keep the comparators a strict weak ordering
+    auto asks = std::partition(orders.begin(), orders.end(), [](const Order& order) { return order.side == OrderSide::Buy; });
+    std::sort(orders.begin(), asks, [](const Order& a, const Order& b) {
+        return a.price != b.price ? a.price > b.price : a.agent < b.agent;
+    });
+    std::sort(asks, orders.end(), [](const Order& a, const Order& b) {
+        return a.price != b.price ? a.price < b.price : a.agent < b.agent;
+    });
+
+    // 2. Crossing bounds of the clearing price
+    auto bid = orders.begin();
+    auto ask = asks;
+    if (bid == asks || ask == orders.end() || bid->price < ask->price) return;
+    Quantity bidLeft = bid->quantity;
+    Quantity askLeft = ask->quantity;
+    Money lowestBid = bid->price;
+    Money highestAsk = ask->price;
+    while (bid != asks && ask != orders.end() && bid->price >= ask->price) {
+        lowestBid = bid->price;
+        highestAsk = ask->price;
+        Quantity matched = std::min(bidLeft, askLeft);
+        bidLeft -= matched;
+        askLeft -= matched;
+        if (bidLeft == 0 && ++bid != asks) bidLeft = bid->quantity;
+        if (askLeft == 0 && ++ask != orders.end()) askLeft = ask->quantity;
+    }
+    Money clearingPrice = std::clamp(Money(productsPricer.getPrice(product)), highestAsk, lowestBid);
+
+    // 3. Volumes are summed level by level in the same order as allocation, so the short side matches exactly
+    auto levelEnd = [](auto first, auto last) {
+        return std::find_if(first, last, [price = first->price](const Order& order) { return order.price != price; });
+    };
+    auto levelQuantity = [](auto first, auto last) {
+        Quantity quantity = 0;
+        for (; first != last; ++first) quantity += first->quantity;
+        return quantity;
+    };
+    auto eligibleVolume = [&](auto first, auto last, auto eligible) {
+        Quantity volume = 0;
+        for (auto level = first; level != last && eligible(level->price); level = levelEnd(level, last)) {
+            volume += levelQuantity(level, levelEnd(level, last));
+        }
+        return volume;
+    };
+    auto allocate = [&](auto first, auto last, Quantity volume) {
+        Quantity filled = 0;
+        for (auto level = first; level != last;) {
+            auto end = levelEnd(level, last);
+            Quantity quantity = levelQuantity(level, end);
+            if (filled + quantity <= volume) {
+                filled += quantity;                                  // level is filled completely
+            } else {
+                double ratio = filled < volume ? (volume - filled) / quantity : 0.0;
+                for (auto order = level; order != end; ++order) order->quantity *= ratio;   // pro rata
+                filled = volume;
+            }
+            level = end;
+        }
+    };
+    Quantity demand = eligibleVolume(orders.begin(), asks, [clearingPrice](Money price) { return price >= clearingPrice; });
+    Quantity supply = eligibleVolume(asks, orders.end(), [clearingPrice](Money price) { return price <= clearingPrice; });
+    Quantity volume = std::min(demand, supply);
+    allocate(orders.begin(), asks, volume);
+    allocate(asks, orders.end(), volume);
+    clearedVolume[product] = volume;
+
+    // 4. Pair filled quantities, both sides total the executed volume
+    size_t slot = ordersOffsets[product], count = 0;
+    bid = orders.begin();
+    ask = asks;
+    bidLeft = bid->quantity;
+    askLeft = ask->quantity;
+    while (bid != asks && ask != orders.end()) {
+        if (bidLeft <= 0) { if (++bid != asks) bidLeft = bid->quantity; continue; }
+        if (askLeft <= 0) { if (++ask != orders.end()) askLeft = ask->quantity; continue; }
+        Quantity traded = std::min(bidLeft, askLeft);
+        tickTrades.write(slot + count++, Trade{ product, bid->agent, ask->agent, traded, clearingPrice }, bid->handle, ask->handle);
+        bidLeft -= traded;
+        askLeft -= traded;
     }
+    tradesCount[product] = count;
 
 }
 
 
 
 //----------------------------------------------------------------------------------------------------
-// Pro rata product clearing
+// Add agent to the pool of its type, agent ID is the order of addition over all pools
 //----------------------------------------------------------------------------------------------------
-void MarketEngine::processProductClearing(const ProductID productID) {
-    
-    auto orders = ordersBook[productID];
-    auto demand = aggregateDemand[productID];
-    auto supply = aggregateSupply[productID];
+AgentID MarketEngine::addAgent(Household agent) {
+    agent.agentID = agents.size();
+    agents.push_back({ EconomicAgentType::Household, uint32_t(households.add(std::move(agent))) });
+    return agents.size() - 1;
+}
+
+
+AgentID MarketEngine::addAgent(Firm agent) {
+    agent.agentID = agents.size();
+    agents.push_back({ EconomicAgentType::Firm, uint32_t(firms.add(std::move(agent))) });
+    return agents.size() - 1;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Find agent in its pool, reference is valid until the next agent of the same type is added
+//----------------------------------------------------------------------------------------------------
+const EconomicAgent& MarketEngine::getAgent(AgentID agent) const {
+    const AgentLocation& location = agents[agent];
+    if (location.type == EconomicAgentType::Household) return households[location.index];
+    return firms[location.index];
+}
 
-    // 1. Sort sell orders in ascending order (best price is lowest)
-    // 2. Sort buy orders in descending order (best price is highest)
-    // 3. Iterate through buy orders and fulfill sell orders:
-    //    - if sell price < buy price - fullfill orders
-    //    - if sell price are same - fullfill buy orders pro rata
-    //    - execute trade (buyer, seller, quantity, trade price)
 
+EconomicAgent& MarketEngine::agentByID(AgentID agent) {
+    const AgentLocation& location = agents[agent];
+    if (location.type == EconomicAgentType::Household) return households[location.index];
+    return firms[location.index];
 }
 
+
+size_t MarketEngine::getAgentsCount() const {
+    return agents.size();
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Product of the loaded catalog, e.g. to validate agents endowments before they are deposited
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::hasProduct(ProductID productID) const {
+    return productsPricer.getIndexByProductID(productID) != NOT_FOUND;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Endow agent with cash or products, e.g. initial balances of the constrained auction
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::deposit(AgentID agent, Money cash) {
+    if (agent >= agents.size()) return false;
+    agentByID(agent).cash += cash;
+    return true;
+}
+
+
+bool MarketEngine::deposit(AgentID agent, ProductID productID, Quantity quantity) {
+    if (agent >= agents.size() || productsPricer.getIndexByProductID(productID) == NOT_FOUND) return false;
+    agentByID(agent).changeQuantity(productID, quantity);
+    return true;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Call auction: per-tick batch clearing of staged orders and crossing resting orders, constrained
+// auction additionally keeps trades within agents cash and inventory. Continuous: orders match on
+// arrival against price-time priority limit order books. Resting orders of auctions are not valid
+// in continuous mode and vice versa, switching between them cancels all resting orders.
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::setClearingMode(ClearingMode mode) {
+    if ((mode == ClearingMode::Continuous) != (clearingMode == ClearingMode::Continuous)) {
+        limitOrderBook.reset(productsPricer.getProductsCount());
+        tickOrders.clear();
+    }
+    clearingMode = mode;
+}
+
+
+ClearingMode MarketEngine::getClearingMode() const {
+    return clearingMode;
+}
+
+
+const LimitOrderBook& MarketEngine::getLimitOrderBook() const {
+    return limitOrderBook;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Submit order of one tick: staged for the tick auction or matched immediately in continuous mode,
+// unfilled remainder expires at the end of tick
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::submitOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side) {
+    Order order;
+    if (!makeOrder(agent, productID, qty, limitPrice, side, order)) return false;
+    if (clearingMode != ClearingMode::Continuous) {
+        submittedOrders.push_back(order);
+        return true;
+    }
+    OrderHandle handle = matchOrder(order);
+    if (handle != NO_ORDER) tickOrders.push_back(handle);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Submit orders of one tick of one agent for one product and side, e.g. a price ladder: the product
+// is resolved once and call auction orders are appended to the tick orders buffer in one reservation
+// @return number of accepted orders, quotes with invalid quantity or limit price are skipped
+//----------------------------------------------------------------------------------------------------
+size_t MarketEngine::submitOrders(AgentID agent, ProductID productID, OrderSide side, std::span<const Quote> quotes) {
+    size_t product = productsPricer.getIndexByProductID(productID);
+    if (agent >= agents.size() || product == NOT_FOUND) return 0;
+    if (clearingMode != ClearingMode::Continuous) submittedOrders.reserve(submittedOrders.size() + quotes.size());
+    size_t accepted = 0;
+    for (const Quote& quote : quotes) {
+        if (!validLimits(quote.quantity, quote.price)) continue;
+        Order order{ ProductIndex(product), quote.quantity, quote.price, side, agent };
+        if (clearingMode != ClearingMode::Continuous) submittedOrders.push_back(order);
+        else {
+            OrderHandle handle = matchOrder(order);
+            if (handle != NO_ORDER) tickOrders.push_back(handle);
+        }
+        accepted++;
+    }
+    return accepted;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Submit good-till-cancelled order: it rests in the order book across ticks until filled or
+// cancelled, handle is NO_ORDER if the order was filled on arrival
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::submitOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side, OrderHandle& handle) {
+    handle = NO_ORDER;
+    Order order;
+    if (!makeOrder(agent, productID, qty, limitPrice, side, order)) return false;
+    handle = clearingMode == ClearingMode::Continuous ? matchOrder(order) : limitOrderBook.rest(order);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Amend resting order: quantity decrease keeps time priority, price change or quantity increase
+// replaces the order (and matches it in continuous mode), handle is updated
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::amendOrder(OrderHandle& handle, Quantity qty, Money limitPrice) {
+    const Order* resting = limitOrderBook.getOrder(handle);
+    if (resting == nullptr || !validLimits(qty, limitPrice)) return false;
+    if (limitPrice == resting->price && qty <= resting->quantity) return limitOrderBook.reduce(handle, qty);
+    Order order = *resting;
+    order.quantity = qty;
+    order.price = limitPrice;
+    limitOrderBook.cancel(handle);
+    handle = clearingMode == ClearingMode::Continuous ? matchOrder(order) : limitOrderBook.rest(order);
+    return true;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Cancel resting order, false if it was already filled or cancelled
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::cancelOrder(OrderHandle handle) {
+    return limitOrderBook.cancel(handle);
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Validate agent, product and limits, false for unknown ones or invalid quantity or limit price
+//----------------------------------------------------------------------------------------------------
+bool MarketEngine::makeOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side, Order& order) const {
+    size_t product = productsPricer.getIndexByProductID(productID);
+    if (agent >= agents.size() || product == NOT_FOUND || !validLimits(qty, limitPrice)) return false;
+    order = Order{ ProductIndex(product), qty, limitPrice, side, agent };
+    return true;
+}
+
+
+//----------------------------------------------------------------------------------------------------
+// Continuous mode: match order on arrival and settle fills immediately, traded quantity feeds
+// pricer aggregates of both sides, remainder rests in the order book
+//----------------------------------------------------------------------------------------------------
+OrderHandle MarketEngine::matchOrder(const Order& order) {
+    trades.clear();
+    OrderHandle handle = limitOrderBook.submit(order, trades);
+    for (const Trade& trade : trades) {
+        executeTrade(trade.product, trade.buyer, trade.seller, trade.quantity, trade.price);
+        aggregateDemand[trade.product] += trade.quantity;
+        aggregateSupply[trade.product] += trade.quantity;
+        clearedVolume[trade.product] += trade.quantity;
+    }
+    return handle;
+}
+
+
+
+//----------------------------------------------------------------------------------------------------
+// Settle trade between agents: trade value is rounded once, balances change by exactly the same amount
+//----------------------------------------------------------------------------------------------------
+void MarketEngine::executeTrade(ProductIndex product, AgentID buyer, AgentID seller, Quantity qty, Money tradePrice) {
+    Money value = tradePrice * qty;
+    ProductID productID = productsPricer.getProductID(product);
+    agentByID(buyer).cash -= value;
+    agentByID(buyer).changeQuantity(productID, qty);
+    agentByID(seller).cash += value;
+    agentByID(seller).changeQuantity(productID, -qty);
+}
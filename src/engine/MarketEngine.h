@@ -1,4 +1,4 @@
-/*=============================================================================
+﻿/*=============================================================================
 *
 *   Market Engine 
 *   
@@ -11,11 +11,21 @@
 
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <compare>
 #include <cstdint>
 #include <cmath>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 #include <iostream>
+#include <memory>
 
 #include "libs/json.hpp"
 
@@ -25,9 +35,51 @@ namespace Axionomy {
 
     constexpr size_t NOT_FOUND = 0xFFFFFFFFFFFFFFFF;
 
+    //-------------------------------------------------------------------------
+    // Fixed-point money: 64-bit integer count of 10^-Decimals units. Sums are
+    // exact and independent of summation order and thread count, arrays of
+    // FixedMoney are plain int64 arrays for integer SIMD. Values above
+    // 2^53 units lose precision when multiplied by quantities.
+    //-------------------------------------------------------------------------
+    template <int Decimals>
+    class FixedMoney {
+    public:
+        static constexpr int64_t scale = [] { int64_t s = 1; for (int i = 0; i < Decimals; i++) s *= 10; return s; }();
+
+        constexpr FixedMoney() = default;
+        explicit FixedMoney(double value) : units(std::llround(value * double(scale))) {}
+        static constexpr FixedMoney fromUnits(int64_t units) { FixedMoney money; money.units = units; return money; }
+
+        constexpr int64_t getUnits() const { return units; }
+        explicit operator double() const { return double(units) / double(scale); }
+
+        constexpr FixedMoney operator-() const { return fromUnits(-units); }
+        constexpr FixedMoney operator+(FixedMoney other) const { return fromUnits(units + other.units); }
+        constexpr FixedMoney operator-(FixedMoney other) const { return fromUnits(units - other.units); }
+        constexpr FixedMoney& operator+=(FixedMoney other) { units += other.units; return *this; }
+        constexpr FixedMoney& operator-=(FixedMoney other) { units -= other.units; return *this; }
+        FixedMoney operator*(double factor) const { return fromUnits(std::llround(double(units) * factor)); }
+        friend FixedMoney operator*(double factor, FixedMoney money) { return money * factor; }
+        constexpr auto operator<=>(const FixedMoney&) const = default;
+
+    private:
+        int64_t units = 0;
+    };
+
+#if !defined(AXIONOMY_MONEY_DECIMALS)
+#define AXIONOMY_MONEY_DECIMALS 4
+#endif
+
+    using Price = double;            // Pricer arithmetic: market prices and costs
+#if defined(AXIONOMY_FIXED_MONEY)
+    using Money = FixedMoney<AXIONOMY_MONEY_DECIMALS>;  // Balances, orders and settlement
+    static_assert(sizeof(Money) == sizeof(int64_t));
+#else
     using Money = double;
+#endif
     using Quantity = double;
     using ProductID = size_t;
+    using ProductIndex = uint32_t;   // Dense product index used inside the engine
     using AgentID = size_t;
     
     struct Item {
@@ -37,16 +89,43 @@ namespace Axionomy {
     
     using BillOfMaterials = std::vector<Item>;
     enum class OrderSide : uint16_t { Buy, Sell };
+
+    //-------------------------------------------------------------------------
+    // Limit price and quantity of one order of a batch
+    //-------------------------------------------------------------------------
+    struct Quote {
+        Quantity quantity;     // Order quantity
+        Money price;           // Limit price
+    };
+
+    using OrderHandle = uint64_t;                 // Resting order: node generation and node index
+    constexpr OrderHandle NO_ORDER = ~OrderHandle(0);
     
     //-------------------------------------------------------------------------
     // Order data structure
     //-------------------------------------------------------------------------
-    struct Order : Item {
+    struct Order {
+        ProductIndex product;  // Dense product index
+        Quantity quantity;     // Order quantity
         Money price;           // Order price
         OrderSide side;        // Order side
         AgentID agent;         // Order agent
+        OrderHandle handle = NO_ORDER;  // Resting order the auction fills, NO_ORDER for orders of one tick
     };
     
+    //-------------------------------------------------------------------------
+    // Trade between two agents at one price
+    //-------------------------------------------------------------------------
+    struct Trade {
+        ProductIndex product;  // Dense product index
+        AgentID buyer;         // Buyer agent
+        AgentID seller;        // Seller agent
+        Quantity quantity;     // Traded quantity
+        Money price;           // Trade price
+    };
+
+    enum class ClearingMode : uint16_t { CallAuction, ConstrainedAuction, Continuous };
+
     enum class ProductType : uint16_t { Good, Service };
     enum class ProductUnit : uint16_t { Piece, Kg, Liter, Hour };
 
@@ -57,8 +136,8 @@ namespace Axionomy {
         ProductID productID;       // Product ID
         ProductType type;          // Good or Service
         ProductUnit unit;          // Measurement unit
-        Money    price;            // Market price
-        Money    cost;             // Product cost based on bills of materials
+        Price    price;            // Market price
+        Price    cost;             // Product cost based on bills of materials
         Quantity demand;           // Aggregate demand quantity
         Quantity supply;           // Aggregate supply quantity  
         double   importance;       // Aggregate consumer importance
@@ -68,9 +147,60 @@ namespace Axionomy {
         BillOfMaterials materials; // Bill of materials
     };
 
+    //-------------------------------------------------------------------------
+    // Allocator of cache line aligned arrays
+    //-------------------------------------------------------------------------
+    template <typename T>
+    struct CacheAlignedAllocator {
+        using value_type = T;
+        static constexpr size_t alignment = 64;
+
+        CacheAlignedAllocator() = default;
+        template <typename U> CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+        T* allocate(size_t count) { return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(alignment))); }
+        void deallocate(T* data, size_t) { ::operator delete(data, std::align_val_t(alignment)); }
+        template <typename U> bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    };
+
+    template <typename T>
+    using AlignedVector = std::vector<T, CacheAlignedAllocator<T>>;
+
     using ProductsList = std::vector<Product>;
     using ProductsIndex = std::unordered_map<ProductID, size_t>;
-    using ProductsAggregate = std::unordered_map<ProductID, Quantity>;
+    using ProductsAggregate = std::vector<Quantity>;
+
+
+    //-------------------------------------------------------------------------
+    // Thread pool for indexed parallel loops
+    //-------------------------------------------------------------------------
+    class ThreadPool {
+    public:
+        using Task = std::function<void(size_t index, size_t worker)>;
+
+        explicit ThreadPool(size_t threadsCount = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t getThreadsCount() const;
+        void parallelFor(size_t count, const Task& task);
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable done;
+        const Task* currentTask = nullptr;
+        size_t tasksCount = 0;
+        std::atomic<size_t> nextIndex{ 0 };
+        size_t activeWorkers = 0;
+        size_t generation = 0;
+        bool stopping = false;
+
+        void workerLoop(size_t worker);
+        void runTasks(size_t worker);
+    };
 
 
     //-------------------------------------------------------------------------
@@ -79,6 +209,12 @@ namespace Axionomy {
     class ProductsLoader {
     public:
         static size_t loadProductList(const std::string& path, ProductsList& productsList);
+        static size_t loadProductList(const std::string& path, ProductsList& productsList, ThreadPool* threadPool);
+        static size_t loadProductListDOM(const std::string& path, ProductsList& productsList);
+        static size_t loadProductImage(const std::string& path, ProductsList& productsList, bool verifyChecksum = false);
+        static bool saveProductList(const std::string& path, const ProductsList& productsList);
+        static bool saveProductImage(const std::string& path, const ProductsList& productsList);
+        static bool linkProductList(ProductsList& productsList);
     private:
 
         ProductsLoader() = delete;
@@ -86,9 +222,174 @@ namespace Axionomy {
         ProductsLoader(const ProductsLoader&) = delete;
         ProductsLoader& operator=(const ProductsLoader&) = delete;
 
+        static bool listCatalogShards(const std::string& path, std::vector<std::string>& shards);
+        static size_t parseCatalogShard(const std::string& path, ProductsList& productsList);
+        static size_t parseProductList(const std::string& path, ProductsList& productsList);
+        static size_t parseProductImage(const std::string& path, ProductsList& productsList, bool verifyChecksum = false);
         static bool validateSchema(json& productList);
         static bool loadProduct(json& productData, ProductsList& productsList);
-        static bool productListContains(ProductID productID, const ProductsList& productsList);
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Synthetic workload (products catalog and agents population) generator
+    //-------------------------------------------------------------------------
+    enum class ImportanceDistribution : uint16_t { Uniform, Normal, Exponential };
+
+    struct WorkloadConfig {
+        size_t productsCount = 1000;       // Number of products
+        size_t depth = 4;                  // Number of BoM levels (level 0 has no inputs)
+        size_t fanIn = 3;                  // Maximum number of inputs per product
+        ImportanceDistribution importance = ImportanceDistribution::Normal;
+        double importanceMean = 0.3;       // Mean consumer importance
+        double importanceSpread = 0.1;     // Half-width (uniform) or deviation (normal)
+        size_t householdsCount = 10000;    // Number of households
+        size_t firmsCount = 1000;          // Number of firms
+        uint64_t seed = 2025;              // Random generator seed
+    };
+
+    class MarketEngine;
+
+    class WorkloadGenerator {
+    public:
+        static bool getPreset(const std::string& name, WorkloadConfig& config);
+        static void generateProducts(const WorkloadConfig& config, ProductsList& productsList);
+        static bool saveAgents(const std::string& path, const WorkloadConfig& config, const ProductsList& productsList);
+        static size_t loadAgents(const std::string& path, MarketEngine& engine);
+    private:
+        WorkloadGenerator() = delete;
+        ~WorkloadGenerator() = delete;
+        WorkloadGenerator(const WorkloadGenerator&) = delete;
+        WorkloadGenerator& operator=(const WorkloadGenerator&) = delete;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Difference between loaded and reloaded products catalogs
+    //-------------------------------------------------------------------------
+    struct ProductsDiff {
+        std::vector<ProductID> added;    // Products missing in the loaded catalog
+        std::vector<ProductID> removed;  // Products missing in the reloaded catalog
+        std::vector<ProductID> changed;  // Products with changed parameters or BoM
+        std::vector<size_t> remap;       // New dense index of every previously loaded product or NOT_FOUND
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Batch price multiplier kernels (asymmetric sigmoid of demand/supply)
+    //-------------------------------------------------------------------------
+    enum class PricingKernel : uint16_t { Scalar, AVX2, AVX512 };
+    enum class PricingPrecision : uint16_t { Double, Float, FastFloat };
+
+    class PricingKernels {
+    public:
+        static constexpr double tolerance = 1e-12;   // Maximum relative deviation from scalar kernel
+
+        static double getTolerance(PricingPrecision precision);
+        static double evaluateMultiplier(Quantity demand, Quantity supply, double importance,
+            PricingPrecision precision = PricingPrecision::Double);
+        static void evaluateMultipliers(PricingKernel kernel, const Quantity* demand, const Quantity* supply,
+            const double* importance, double* multiplier, size_t count, PricingPrecision precision = PricingPrecision::Double);
+        static bool isSupported(PricingKernel kernel);
+        static PricingKernel detect();
+    private:
+        PricingKernels() = delete;
+        ~PricingKernels() = delete;
+        PricingKernels(const PricingKernels&) = delete;
+        PricingKernels& operator=(const PricingKernels&) = delete;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Hot per-tick numeric state of all products (structure of arrays)
+    //-------------------------------------------------------------------------
+    struct ProductsState {
+        std::vector<Price>    price;       // Market prices
+        std::vector<Price>    cost;        // Costs based on bills of materials
+        std::vector<Quantity> demand;      // Aggregate demand quantities
+        std::vector<Quantity> supply;      // Aggregate supply quantities
+        std::vector<double>   importance;  // Aggregate consumer importance
+        std::vector<double>   floorMargin; // Minimal industry margins
+        std::vector<double>   turnover;    // Average turnover durations in days
+        std::vector<double>   multiplier;  // Demand/supply price multipliers of the last evaluation
+
+        size_t size() const { return price.size(); }
+        void resize(size_t count);
+    };
+
+    //-------------------------------------------------------------------------
+    // Cold product metadata, rarely touched during simulation
+    //-------------------------------------------------------------------------
+    struct ProductInfo {
+        ProductID productID;       // Product ID
+        ProductType type;          // Good or Service
+        ProductUnit unit;          // Measurement unit
+        std::string name;          // Product name
+        BillOfMaterials materials; // Bill of materials
+    };
+
+    //-------------------------------------------------------------------------
+    // Bills of materials of all products as compressed sparse row matrix:
+    // row - consumer product, column - input product (dense indices)
+    //-------------------------------------------------------------------------
+    struct MaterialsMatrix {
+        std::vector<uint32_t> rowOffsets{ 0 };  // Row i spans [rowOffsets[i], rowOffsets[i + 1])
+        std::vector<ProductIndex> inputs;       // Dense indices of input products
+        std::vector<Quantity> quantities;       // Input quantities
+
+        size_t rows() const { return rowOffsets.size() - 1; }
+        void clear();
+        void appendRow(const BillOfMaterials& materials, const ProductsIndex& indexByID);
+        void transpose(MaterialsMatrix& transposed) const;  // row - input, column - consumer
+    };
+
+    //-------------------------------------------------------------------------
+    // Read-only view of a single product assembled from hot and cold stores
+    //-------------------------------------------------------------------------
+    struct ProductView {
+        const ProductID& productID;
+        const ProductType& type;
+        const ProductUnit& unit;
+        const Price& price;
+        const Price& cost;
+        const Quantity& demand;
+        const Quantity& supply;
+        const double& importance;
+        const double& floorMargin;
+        const double& turnover;
+        const std::string& name;
+        const BillOfMaterials& materials;
+
+        operator Product() const;
+    };
+
+    //-------------------------------------------------------------------------
+    // Lightweight read-only view of the products list
+    //-------------------------------------------------------------------------
+    class ProductsView {
+    public:
+        class Iterator {
+        public:
+            Iterator(const ProductsView& view, size_t index) : view(view), index(index) {}
+            ProductView operator*() const { return view[index]; }
+            Iterator& operator++() { index++; return *this; }
+            bool operator!=(const Iterator& other) const { return index != other.index; }
+        private:
+            const ProductsView& view;
+            size_t index;
+        };
+
+        ProductsView(const std::vector<ProductInfo>& info, const ProductsState& state) : info(info), state(state) {}
+
+        size_t size() const { return info.size(); }
+        bool empty() const { return info.empty(); }
+        ProductView operator[](size_t index) const;
+        Iterator begin() const { return Iterator(*this, 0); }
+        Iterator end() const { return Iterator(*this, size()); }
+
+    private:
+        const std::vector<ProductInfo>& info;
+        const ProductsState& state;
     };
 
 
@@ -97,19 +398,244 @@ namespace Axionomy {
     //-------------------------------------------------------------------------
     class ProductsPricer {
     public:
+        static constexpr double FAST_FORWARD_TOLERANCE = 1e-9;  // Relative distance to target of stationary prices
+
+        ProductsPricer(const std::string& path, bool verifyImage = false);
 
-        ProductsPricer(const std::string& path);
+        bool reloadProducts(const std::string& path, ProductsDiff& diff);
 
-        const ProductsList& getProductsList() const;
+        ProductsView getProductsList() const;
+        const ProductsState& getProductsState() const;
+        size_t getProductsCount() const;
+        ProductID getProductID(size_t index) const;
         size_t getIndexByProductID(ProductID productID) const;
         Money getProductPrice(ProductID productID) const;
+        Price getPrice(size_t index) const;
         bool computeEquilibriumPrice(ProductID productID, Quantity demand, Quantity supply);
 
+        void setMarketData(size_t index, Quantity demand, Quantity supply);
+        void evaluatePrices();
+        void fastForward(size_t ticks, double tolerance = FAST_FORWARD_TOLERANCE);
+
+        PricingKernel getPricingKernel() const;
+        bool setPricingKernel(PricingKernel kernel);
+        PricingPrecision getPricingPrecision() const;
+        void setPricingPrecision(PricingPrecision precision);
+        size_t getLevelsCount() const;
+        void setThreadPool(ThreadPool* pool);
+        void setIncrementalPricing(bool enabled, double epsilon = 1e-9);
+        bool isIncrementalPricing() const;
+        size_t getRepricedCount() const;
+
+    private:
+        static constexpr size_t PARALLEL_CHUNK = 4096;  // Products per parallel task
+
+        ProductsState state;               // Hot numeric state
+        std::vector<ProductInfo> info;     // Cold metadata
+        MaterialsMatrix materials;         // Bills of materials by dense index
+        MaterialsMatrix consumers;         // Transposed bills of materials, input to consumers
+        std::vector<uint32_t> levels;      // BoM level of every product
+        std::vector<uint32_t> levelOffsets;// BoM level boundaries over dense indices, empty if not leveled
+        ProductsIndex indexByID;           // External ID to dense index, API boundary only
+        PricingKernel pricingKernel = PricingKernels::detect();
+        PricingPrecision pricingPrecision = PricingPrecision::Double;
+        ThreadPool* threadPool = nullptr;  // Optional, evaluates BoM levels in parallel
+
+        bool incremental = false;          // Reprice dirty products only
+        double epsilon = 1e-9;             // Relative price move that is propagated to consumers
+        std::vector<uint8_t> dirty;        // Product is queued for repricing
+        std::vector<Price> propagatedPrice;// Price consumers were last repriced with
+        std::vector<std::vector<ProductIndex>> dirtyLevels;  // Dirty products by BoM level
+        std::vector<ProductIndex> repricing;                 // Level being repriced
+        size_t repricedCount = 0;          // Products repriced by the last evaluation
+
+        void assignProducts(ProductsList& productsList);
+        bool assignProductImage(const std::string& path, bool verifyChecksum);
+        void initializeCatalog();
+        void evaluateRange(size_t begin, size_t end, bool multipliers);
+        void evaluateDirtyProducts();
+        void markDirty(size_t index);
+        void markAllDirty();
+        void evaluateProductPrice(size_t index);
+        void adjustProductPrice(size_t index);
+        void evaluateProductCost(size_t index);
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Price history of all products: last K ticks of market data in ring
+    // buffers with rolling statistics maintained in O(1) per product and tick
+    //-------------------------------------------------------------------------
+    class PriceHistory {
+    public:
+        static constexpr size_t DEFAULT_CAPACITY = 16;
+
+        explicit PriceHistory(size_t capacity = DEFAULT_CAPACITY);
+
+        void reset(size_t productsCount);
+        void remap(const ProductsDiff& diff, const ProductsState& state);
+        void record(const ProductsState& state, const Quantity* volume);
+        void setSmoothing(double alpha);
+
+        size_t getCapacity() const;
+        size_t getDepth() const;
+        size_t getTicksCount() const;
+
+        // Market data as of lag ticks ago, lag 0 is the last recorded tick
+        Price getPrice(ProductIndex product, size_t lag = 0) const;
+        Price getCost(ProductIndex product, size_t lag = 0) const;
+        Quantity getDemand(ProductIndex product, size_t lag = 0) const;
+        Quantity getSupply(ProductIndex product, size_t lag = 0) const;
+        Quantity getVolume(ProductIndex product, size_t lag = 0) const;
+
+        // Rolling statistics over the recorded window
+        Price getMean(ProductIndex product) const;
+        Price getEMA(ProductIndex product) const;
+        Price getVWAP(ProductIndex product) const;
+        double getVolatility(ProductIndex product) const;
+
+    private:
+        size_t capacity;                    // Ticks kept, K
+        size_t productsCount = 0;
+        size_t stride = 0;                  // Row length padded to cache line
+        size_t ticksCount = 0;              // Ticks recorded since reset
+        double smoothing;                   // EMA smoothing factor
+
+        // Ring buffers, one row of all products per tick
+        AlignedVector<Price> prices;
+        AlignedVector<Price> costs;
+        AlignedVector<Quantity> demands;
+        AlignedVector<Quantity> supplies;
+        AlignedVector<Quantity> volumes;
+
+        // Running sums over the window by product
+        AlignedVector<Price> priceSum;
+        AlignedVector<double> valueSum;     // price * volume
+        AlignedVector<Quantity> volumeSum;
+        AlignedVector<double> returnSum;    // tick to tick relative price changes
+        AlignedVector<double> returnSquares;
+        AlignedVector<Price> ema;
+
+        size_t slot(size_t lag) const;
+        void recomputeStatistics();
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Price-time priority limit order books of all products: resting orders
+    // live across ticks until filled or cancelled. Continuous mode matches
+    // incoming orders on arrival, call auction mode rests them unmatched and
+    // fills crossing orders in the tick auction
+    //-------------------------------------------------------------------------
+    class LimitOrderBook {
+    public:
+        void reset(size_t productsCount);
+        void remap(const ProductsDiff& diff, size_t productsCount);
+
+        OrderHandle submit(const Order& order, std::vector<Trade>& trades);
+        OrderHandle rest(const Order& order);
+        bool reduce(OrderHandle handle, Quantity quantity);
+        void fill(OrderHandle handle, Quantity quantity);
+        bool cancel(OrderHandle handle);
+        void collect(ProductIndex product, OrderSide side, Money limitPrice, std::vector<Order>& orders) const;
+
+        const Order* getOrder(OrderHandle handle) const;
+        Money getBestPrice(ProductIndex product, OrderSide side) const;
+        Quantity getBestQuantity(ProductIndex product, OrderSide side) const;
+        Quantity getOpenQuantity(ProductIndex product, OrderSide side) const;
+        Quantity getRestingQuantity(OrderHandle handle) const;
+        size_t getLevelsCount(ProductIndex product, OrderSide side) const;
+        size_t getOrdersCount() const;
+
+    private:
+        static constexpr uint32_t NIL = ~uint32_t(0);
+
+        // Price level: intrusive FIFO queue of resting orders
+        struct PriceLevel {
+            Money price;
+            Quantity quantity;             // Resting quantity of the level
+            uint32_t head;                 // Oldest order
+            uint32_t tail;                 // Newest order
+        };
+
+        // Best price first: bids by descending, asks by ascending price
+        struct LevelOrder {
+            bool descending = false;
+            bool operator()(Money a, Money b) const { return descending ? a > b : a < b; }
+        };
+        using PriceLevels = std::map<Money, PriceLevel, LevelOrder>;
+
+        // Pooled order node, linked into the FIFO queue of its price level or into the free list
+        struct OrderNode {
+            Order order;
+            PriceLevels::iterator level;   // Level of resting order, iterators stay valid until the level is erased
+            uint32_t prev = NIL;
+            uint32_t next = NIL;
+            uint32_t generation = 0;       // Incremented on release, stale handles do not match
+            bool live = false;
+        };
+
+        // Levels ordered from the best price, the best level is the first one
+        struct ProductBook {
+            PriceLevels bids{ LevelOrder{ true } };
+            PriceLevels asks{ LevelOrder{ false } };
+            Quantity bidQuantity = 0;      // Open demand, updated on every book change
+            Quantity askQuantity = 0;      // Open supply
+        };
+
+        std::vector<ProductBook> books;    // Books by dense product index
+        std::vector<OrderNode> nodes;      // Order nodes pool
+        uint32_t freeNodes = NIL;          // Free list head
+        size_t ordersCount = 0;
+
+        uint32_t acquireNode(const Order& order);
+        void releaseNode(uint32_t node);
+        void unlink(PriceLevel& level, uint32_t node);
+        void match(Order& order, ProductBook& book, std::vector<Trade>& trades);
+        void remove(uint32_t node, Quantity quantity);
+        uint32_t findNode(OrderHandle handle) const;
+        const PriceLevel* bestLevel(ProductIndex product, OrderSide side) const;
+    };
+
+
+    //-------------------------------------------------------------------------
+    // Trades of one tick as columns (structure of arrays): clearing writes
+    // trade slots, settlement compacts them in product order and partitions
+    // their cash and inventory postings by agent with a counting sort, so
+    // balances of every agent are updated in one streaming pass
+    //-------------------------------------------------------------------------
+    class TradeLedger {
+    public:
+
+        //---------------------------------------------------------------------
+        // Cash and inventory change of one agent by one trade
+        //---------------------------------------------------------------------
+        struct Posting {
+            ProductIndex product;  // Dense product index
+            Quantity quantity;     // Bought quantity, negative when sold
+            Money value;           // Trade value, paid when bought, received when sold
+        };
+
+        std::vector<ProductIndex> product;  // Dense product index
+        std::vector<AgentID>  buyer;        // Buyer agent
+        std::vector<AgentID>  seller;       // Seller agent
+        std::vector<Quantity> quantity;     // Traded quantity
+        std::vector<Money>    price;        // Trade price
+        std::vector<OrderHandle> buyOrder;  // Resting bid the trade fills, NO_ORDER for orders of one tick
+        std::vector<OrderHandle> sellOrder; // Resting ask the trade fills, NO_ORDER for orders of one tick
+
+        size_t size() const { return tradesCount; }
+        void resize(size_t slots);
+        void write(size_t slot, const Trade& trade, OrderHandle bid, OrderHandle ask);
+        void compact(const std::vector<size_t>& offsets, const std::vector<size_t>& counts);
+        void partition(size_t agentsCount);
+        std::span<const Posting> getPostings(AgentID agent) const;
+
     private:
-        ProductsList products;
-        ProductsIndex indexByID;
-        void evaluateProductPrice(Product& product);
-        void evaluateProductCost(Product& product);
+        size_t tradesCount = 0;
+        std::vector<Posting> postings;      // Postings grouped by agent, in trade order within agent
+        std::vector<size_t> agentOffsets;   // Agent postings range, agents count + 1
+        std::vector<size_t> cursors;        // Scatter positions of the counting sort
     };
 
 
@@ -117,40 +643,73 @@ namespace Axionomy {
     // Base interface of simulation entity
     //-------------------------------------------------------------------------
     enum class EconomicAgentType : uint16_t { Household, Firm };
+
+    class MarketEngine;
    
     class EconomicAgent {    
     public:
+        EconomicAgent() = default;
+        EconomicAgent(EconomicAgent&&) noexcept = default;              // Agents move when their pool grows
+        EconomicAgent& operator=(EconomicAgent&&) noexcept = default;
         virtual ~EconomicAgent() = default;
-        virtual void tick() = 0;
-    protected:
-        AgentID  agentID;              // Agent ID
-        std::vector<Item> inventory;   // Inventory (stock)
+        virtual void tick(MarketEngine& engine) = 0;     // Act on market data and submit orders to engine
 
-        // FIXME: I think that there is no reason store store orders here
-        // maybe its better to directly submit orders to the market engine
-        std::vector<Order> buyOrders;  // Buy orders
-        std::vector<Order> sellOrders; // Sell orders
+        AgentID getAgentID() const;
+        Money getCash() const;
+        Money getDebt() const;
+        Quantity getQuantity(ProductID productID) const;
+
+    protected:
+        AgentID  agentID = 0;          // Agent ID
+        std::vector<Item> inventory;   // Inventory (stock), sorted by product ID
 
         Money cash{ 0 };
         Money debt{ 0 };
 
+        void changeQuantity(ProductID productID, Quantity delta);
+
         friend class MarketEngine;
     };
 
     //-------------------------------------------------------------------------
     // Household
     //-------------------------------------------------------------------------
-    class Household : public EconomicAgent {
+    class Household final : public EconomicAgent {
     public:
-        void tick() override;
+        void tick(MarketEngine& engine) override;
     };
 
     //-------------------------------------------------------------------------
     // Firm
     //-------------------------------------------------------------------------
-    class Firm : public EconomicAgent {
+    class Firm final : public EconomicAgent {
     public:
-        void tick() override;
+        void tick(MarketEngine& engine) override;
+    };
+
+    //-------------------------------------------------------------------------
+    // Agents of one concrete type stored contiguously by value. Batch tick
+    // walks the pool linearly and calls the final override directly, without
+    // virtual dispatch. Growing the pool invalidates references to agents
+    //-------------------------------------------------------------------------
+    template <typename Agent>
+    class AgentPool {
+    public:
+        size_t add(Agent&& agent) {
+            agents.push_back(std::move(agent));
+            return agents.size() - 1;
+        }
+
+        void tick(MarketEngine& engine) {
+            for (Agent& agent : agents) agent.Agent::tick(engine);
+        }
+
+        Agent& operator[](size_t index) { return agents[index]; }
+        const Agent& operator[](size_t index) const { return agents[index]; }
+        size_t size() const { return agents.size(); }
+
+    private:
+        std::vector<Agent> agents;
     };
 
 
@@ -161,30 +720,92 @@ namespace Axionomy {
     class MarketEngine {
     public:
 
-        MarketEngine(const std::string& productsList);
+        MarketEngine(const std::string& productsList, size_t historyCapacity = PriceHistory::DEFAULT_CAPACITY);
 
         void processTick();
+        const PriceHistory& getPriceHistory() const;
+        void fastForward(size_t ticks);
+        void setPricingPrecision(PricingPrecision precision);
+        void setThreadPool(ThreadPool* threadPool);
+        bool reloadProducts(const std::string& productsList, ProductsDiff& diff);
             
-        void submitOrder(AgentID agent, Quantity qty, Money limitPrice, OrderSide side);
-        void executeTrade(AgentID buyer, AgentID seller, Quantity qty, Money tradePrice);
+        AgentID addAgent(Household agent);
+        AgentID addAgent(Firm agent);
+        const EconomicAgent& getAgent(AgentID agent) const;
+        size_t getAgentsCount() const;
+        bool hasProduct(ProductID productID) const;
+        bool deposit(AgentID agent, Money cash);
+        bool deposit(AgentID agent, ProductID productID, Quantity quantity);
+
+        void setClearingMode(ClearingMode mode);
+        ClearingMode getClearingMode() const;
+        const LimitOrderBook& getLimitOrderBook() const;
+
+        bool submitOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side);
+        bool submitOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side, OrderHandle& handle);
+        size_t submitOrders(AgentID agent, ProductID productID, OrderSide side, std::span<const Quote> quotes);
+        bool amendOrder(OrderHandle& handle, Quantity qty, Money limitPrice);
+        bool cancelOrder(OrderHandle handle);
+        void executeTrade(ProductIndex product, AgentID buyer, AgentID seller, Quantity qty, Money tradePrice);
             
 
     private:
 
         size_t tickCounter;
+        std::unique_ptr<ThreadPool> threadPool;        // Own workers, stopped while a shared pool is set
+        ThreadPool* pool = nullptr;                    // Pricing and clearing workers, own pool by default
         ProductsPricer productsPricer;
-        std::vector<EconomicAgent> agents;
-        std::unordered_map<ProductID, Quantity> aggregateDemand;
-        std::unordered_map<ProductID, Quantity> aggregateSupply;
 
-        // TODO: I thinks its better to separate buy / sell orders and calculate aggregates in submitOrder method
-        std::unordered_map<ProductID, std::vector<Order>> ordersBook;
+        // Agents in contiguous pools by concrete type, agent ID indexes their pool locations
+        struct AgentLocation {
+            EconomicAgentType type;                    // Pool of the agent
+            uint32_t index;                            // Agent position in its pool
+        };
+        AgentPool<Household> households;
+        AgentPool<Firm> firms;
+        std::vector<AgentLocation> agents;             // Pool locations by agent ID
+
+        ProductsAggregate aggregateDemand;             // Demand by dense product index
+        ProductsAggregate aggregateSupply;             // Supply by dense product index
+        ProductsAggregate clearedVolume;               // Traded quantity by dense product index
+        PriceHistory priceHistory;                     // Last ticks of market data for agents and clients
+
+        ClearingMode clearingMode = ClearingMode::CallAuction;
+        LimitOrderBook limitOrderBook;                 // Good-till-cancelled orders of both modes
+        std::vector<OrderHandle> tickOrders;           // Continuous mode orders expiring at the end of tick
+        std::vector<Trade> trades;                     // Fills of the last continuous submission
+
+        // Orders of the tick, partitioned by dense product index with a counting sort before clearing
+        std::vector<Order> submittedOrders;            // Orders in arrival order
+        std::vector<Order> ordersBook;                 // Orders grouped by dense product index
+        std::vector<size_t> ordersOffsets;             // Product orders range in orders book, products count + 1
+        std::vector<size_t> bidsCount;                 // Bids count by dense product index
+        std::vector<Money> highestBid;                 // Best bid price by dense product index
+        std::vector<Money> lowestAsk;                  // Best ask price by dense product index
+
+        // Parallel clearing: products by descending book size, trade slots share orders book offsets
+        std::vector<ProductIndex> clearingQueue;
+        TradeLedger tickTrades;
+        std::vector<size_t> tradesCount;               // Trades count by dense product index
+
+        // Constrained auction: worst case spending of the tick bids and affordable share by agent
+        std::vector<std::atomic<int64_t>> requestedCash;   // Money units
+        std::vector<double> budgetScale;
+        std::vector<Money> spendableCash;              // Settlement caps in trade order
+        std::vector<Quantity> sellerStock;
                 
         void aggregateSupplyDemand();
         void computeEquilibriumPrice();
         void processMarketClearing();
-        void processProductClearing(const ProductID productID);
+        void reserveBudgets();
+        void applyBudgets(std::span<Order>& orders, ProductIndex product);
+        void processProductClearing(const ProductIndex product);
+        void capTrades();
+        void settleTrades();
+        bool makeOrder(AgentID agent, ProductID productID, Quantity qty, Money limitPrice, OrderSide side, Order& order) const;
+        OrderHandle matchOrder(const Order& order);
         void updateAgentsState();
+        EconomicAgent& agentByID(AgentID agent);
 
 
     };
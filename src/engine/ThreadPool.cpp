@@ -0,0 +1,102 @@
+/**
+ * =============================================================================
+ *
+ * @class ThreadPool
+ * @brief Fixed set of worker threads executing indexed parallel loops.
+ *
+ * The calling thread takes part in every parallel loop as worker zero, so a
+ * pool of N threads starts N - 1 background workers. Loop indices are handed
+ * out dynamically, one at a time, which balances uneven tasks such as
+ * catalog shards of different size.
+ *
+ * Notes:
+ *  - parallelFor blocks until all indices are processed.
+ *  - parallelFor is not reentrant and must be called from one thread.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+
+using namespace Axionomy;
+
+
+ThreadPool::ThreadPool(size_t threadsCount) {
+    if (threadsCount == 0) threadsCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    workers.reserve(threadsCount - 1);
+    for (size_t worker = 1; worker < threadsCount; worker++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, worker);
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+
+size_t ThreadPool::getThreadsCount() const {
+    return workers.size() + 1;
+}
+
+
+/**
+*  @brief Runs task(index, worker) for every index in [0, count) on all threads
+*  @param count number of indices
+*  @param task callable receiving loop index and worker number [0, threads)
+*/
+void ThreadPool::parallelFor(size_t count, const Task& task) {
+    if (count == 0) return;
+    if (workers.empty() || count == 1) {
+        for (size_t index = 0; index < count; index++) task(index, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        tasksCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        activeWorkers = workers.size();
+        generation++;
+    }
+    wakeUp.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return activeWorkers == 0; });
+    currentTask = nullptr;
+}
+
+
+void ThreadPool::workerLoop(size_t worker) {
+    size_t seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+        runTasks(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        done.notify_one();
+    }
+}
+
+
+void ThreadPool::runTasks(size_t worker) {
+    const Task& task = *currentTask;
+    for (;;) {
+        size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (index >= tasksCount) return;
+        task(index, worker);
+    }
+}
@@ -5,3 +5,30 @@
 using namespace Axionomy;
 
 
+AgentID EconomicAgent::getAgentID() const {
+    return agentID;
+}
+
+
+Money EconomicAgent::getCash() const {
+    return cash;
+}
+
+
+Money EconomicAgent::getDebt() const {
+    return debt;
+}
+
+
+Quantity EconomicAgent::getQuantity(ProductID productID) const {
+    auto item = std::lower_bound(inventory.begin(), inventory.end(), productID, [](const Item& i, ProductID id) { return i.productID < id; });
+    return item != inventory.end() && item->productID == productID ? item->quantity : 0;
+}
+
+
+// Inventory is kept sorted by product ID, items are found by binary search
+void EconomicAgent::changeQuantity(ProductID productID, Quantity delta) {
+    auto item = std::lower_bound(inventory.begin(), inventory.end(), productID, [](const Item& i, ProductID id) { return i.productID < id; });
+    if (item != inventory.end() && item->productID == productID) item->quantity += delta;
+    else inventory.insert(item, { productID, delta });
+}
@@ -0,0 +1,330 @@
+/**
+ * =============================================================================
+ *
+ * @class LimitOrderBook
+ * @brief Continuous double auction: price-time priority limit order books of
+ *        all products.
+ *
+ * Every product book keeps bid and ask price levels in ordered maps from the
+ * best price, so matching takes the best level first in O(1), opening and
+ * closing a level at any price costs O(log levels). Resting orders keep the
+ * iterator of their level, so fills and cancels find their level in O(1).
+ *
+ * Price levels are intrusive FIFO queues of order nodes. Nodes come from one
+ * pool shared by all books and are recycled through a free list, so adding,
+ * filling and cancelling orders in existing levels does not allocate once the
+ * pool has grown, only opening a level allocates its map node.
+ * Handles carry node index and node generation, handles of filled or
+ * cancelled orders do not match reused nodes.
+ *
+ * Open demand and supply of every product are kept up to date on every rest,
+ * fill, reduce and cancel, so pricer aggregates of resting orders cost O(1)
+ * per product and tick instead of a pass over all open orders.
+ *
+ * In continuous mode incoming order matches on arrival against the opposite
+ * side at resting orders prices, unfilled remainder rests in its level queue.
+ * In call auction mode orders rest unmatched, books may be crossed until the
+ * tick auction collects crossing orders and fills them.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+
+using namespace Axionomy;
+
+
+namespace {
+
+    // Buy at limit price crosses lower or equal prices, sell crosses higher or equal
+    inline bool crosses(OrderSide side, Money limitPrice, Money price) {
+        return side == OrderSide::Buy ? limitPrice >= price : limitPrice <= price;
+    }
+
+}
+
+
+/**
+*  @brief Drops all resting orders and sizes books for products count
+*  @param productsCount number of products
+*/
+void LimitOrderBook::reset(size_t productsCount) {
+    books.assign(productsCount, {});
+    nodes.clear();
+    freeNodes = NIL;
+    ordersCount = 0;
+}
+
+
+/**
+*  @brief Moves books of retained products to their new dense indices after
+*         catalog reload, orders of removed products are cancelled
+*  @param diff reload result with old to new index remap
+*  @param productsCount number of products in the new catalog
+*/
+void LimitOrderBook::remap(const ProductsDiff& diff, size_t productsCount) {
+    std::vector<ProductBook> remapped(productsCount);
+    for (uint32_t node = 0; node < nodes.size(); node++) {
+        if (!nodes[node].live) continue;
+        size_t index = diff.remap[nodes[node].order.product];
+        if (index == NOT_FOUND) releaseNode(node);
+        else nodes[node].order.product = ProductIndex(index);
+    }
+    for (size_t oldIndex = 0; oldIndex < diff.remap.size() && oldIndex < books.size(); oldIndex++) {
+        if (diff.remap[oldIndex] != NOT_FOUND) remapped[diff.remap[oldIndex]] = std::move(books[oldIndex]);
+    }
+    books = std::move(remapped);
+}
+
+
+/**
+*  @brief Matches order against opposite side of its product book, rests the remainder
+*  @param order incoming limit order
+*  @param trades receives fills at resting orders prices, not cleared
+*  @return handle of the resting remainder, NO_ORDER if the order was filled completely
+*/
+OrderHandle LimitOrderBook::submit(const Order& order, std::vector<Trade>& trades) {
+    Order incoming = order;
+    match(incoming, books[order.product], trades);
+    return incoming.quantity > 0 ? rest(incoming) : NO_ORDER;
+}
+
+
+/**
+*  @brief Appends order at the tail of its price level without matching
+*  @param order limit order
+*  @return resting order handle
+*/
+OrderHandle LimitOrderBook::rest(const Order& order) {
+    ProductBook& book = books[order.product];
+    PriceLevels& levels = order.side == OrderSide::Buy ? book.bids : book.asks;
+    auto level = levels.try_emplace(order.price, PriceLevel{ order.price, 0, NIL, NIL }).first;
+    PriceLevel& queue = level->second;
+    uint32_t node = acquireNode(order);
+    nodes[node].level = level;
+    nodes[node].prev = queue.tail;
+    if (queue.tail != NIL) nodes[queue.tail].next = node;
+    else queue.head = node;
+    queue.tail = node;
+    queue.quantity += order.quantity;
+    (order.side == OrderSide::Buy ? book.bidQuantity : book.askQuantity) += order.quantity;
+    return (OrderHandle(nodes[node].generation) << 32) | node;
+}
+
+
+/**
+*  @brief Reduces resting quantity in place, order keeps its time priority
+*  @param handle resting order handle
+*  @param quantity new quantity, positive and not above the resting one
+*  @return false if the order is not resting or quantity is out of range
+*/
+bool LimitOrderBook::reduce(OrderHandle handle, Quantity quantity) {
+    uint32_t node = findNode(handle);
+    if (node == NIL || !(quantity > 0) || quantity > nodes[node].order.quantity) return false;
+    remove(node, nodes[node].order.quantity - quantity);
+    return true;
+}
+
+
+/**
+*  @brief Applies auction fill to resting order, filled order is removed
+*/
+void LimitOrderBook::fill(OrderHandle handle, Quantity quantity) {
+    uint32_t node = findNode(handle);
+    if (node != NIL) remove(node, std::min(quantity, nodes[node].order.quantity));
+}
+
+
+/**
+*  @brief Removes resting order from its price level
+*  @param handle resting order handle
+*  @return false if the order was already filled or cancelled
+*/
+bool LimitOrderBook::cancel(OrderHandle handle) {
+    uint32_t node = findNode(handle);
+    if (node == NIL) return false;
+    remove(node, nodes[node].order.quantity);
+    return true;
+}
+
+
+/**
+*  @brief Appends copies of resting orders of one side crossing limit price,
+*         best levels first, copies keep handles of resting orders
+*  @param product dense product index
+*  @param side side of resting orders
+*  @param limitPrice lowest bid or highest ask price that may trade
+*  @param orders receives order copies
+*/
+void LimitOrderBook::collect(ProductIndex product, OrderSide side, Money limitPrice, std::vector<Order>& orders) const {
+    const PriceLevels& levels = side == OrderSide::Buy ? books[product].bids : books[product].asks;
+    for (auto level = levels.begin(); level != levels.end() && crosses(side, level->first, limitPrice); ++level) {
+        for (uint32_t node = level->second.head; node != NIL; node = nodes[node].next) {
+            orders.push_back(nodes[node].order);
+            orders.back().handle = (OrderHandle(nodes[node].generation) << 32) | node;
+        }
+    }
+}
+
+
+/**
+*  @brief Fills incoming order from the best opposite levels while prices cross,
+*         oldest orders of a level are filled first
+*/
+void LimitOrderBook::match(Order& order, ProductBook& book, std::vector<Trade>& trades) {
+    bool buy = order.side == OrderSide::Buy;
+    PriceLevels& opposite = buy ? book.asks : book.bids;
+    Quantity& openQuantity = buy ? book.askQuantity : book.bidQuantity;
+    while (order.quantity > 0 && !opposite.empty() && crosses(order.side, order.price, opposite.begin()->first)) {
+        PriceLevel& level = opposite.begin()->second;
+        while (order.quantity > 0 && level.head != NIL) {
+            uint32_t node = level.head;
+            Order& resting = nodes[node].order;
+            Quantity quantity = std::min(order.quantity, resting.quantity);
+            trades.push_back({ order.product, buy ? order.agent : resting.agent, buy ? resting.agent : order.agent, quantity, level.price });
+            order.quantity -= quantity;
+            resting.quantity -= quantity;
+            level.quantity -= quantity;
+            openQuantity -= quantity;
+            if (resting.quantity <= 0) {
+                unlink(level, node);
+                releaseNode(node);
+            }
+        }
+        if (level.head == NIL) opposite.erase(opposite.begin());
+    }
+    if (opposite.empty()) openQuantity = 0;
+}
+
+
+/**
+*  @brief Takes quantity from resting order, removes the order when nothing is left
+*         and its level when the level becomes empty
+*/
+void LimitOrderBook::remove(uint32_t node, Quantity quantity) {
+    Order& order = nodes[node].order;
+    ProductBook& book = books[order.product];
+    PriceLevels& levels = order.side == OrderSide::Buy ? book.bids : book.asks;
+    Quantity& openQuantity = order.side == OrderSide::Buy ? book.bidQuantity : book.askQuantity;
+    auto level = nodes[node].level;
+    order.quantity -= quantity;
+    level->second.quantity -= quantity;
+    openQuantity -= quantity;
+    if (order.quantity <= 0) {
+        unlink(level->second, node);
+        if (level->second.head == NIL) levels.erase(level);
+        releaseNode(node);
+    }
+    if (levels.empty()) openQuantity = 0;
+}
+
+
+/**
+*  @brief Takes node from the free list or grows the pool
+*/
+uint32_t LimitOrderBook::acquireNode(const Order& order) {
+    uint32_t node = freeNodes;
+    if (node != NIL) freeNodes = nodes[node].next;
+    else {
+        node = uint32_t(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node].order = order;
+    nodes[node].prev = NIL;
+    nodes[node].next = NIL;
+    nodes[node].live = true;
+    ordersCount++;
+    return node;
+}
+
+
+/**
+*  @brief Returns node to the free list, outstanding handles become stale
+*/
+void LimitOrderBook::releaseNode(uint32_t node) {
+    nodes[node].live = false;
+    nodes[node].generation++;
+    nodes[node].next = freeNodes;
+    freeNodes = node;
+    ordersCount--;
+}
+
+
+/**
+*  @brief Returns node of resting order, NIL for stale handle
+*/
+uint32_t LimitOrderBook::findNode(OrderHandle handle) const {
+    uint32_t node = uint32_t(handle);
+    if (node >= nodes.size() || !nodes[node].live || nodes[node].generation != uint32_t(handle >> 32)) return NIL;
+    return node;
+}
+
+
+void LimitOrderBook::unlink(PriceLevel& level, uint32_t node) {
+    OrderNode& n = nodes[node];
+    if (n.prev != NIL) nodes[n.prev].next = n.next;
+    else level.head = n.next;
+    if (n.next != NIL) nodes[n.next].prev = n.prev;
+    else level.tail = n.prev;
+}
+
+
+const LimitOrderBook::PriceLevel* LimitOrderBook::bestLevel(ProductIndex product, OrderSide side) const {
+    if (product >= books.size()) return nullptr;
+    const PriceLevels& levels = side == OrderSide::Buy ? books[product].bids : books[product].asks;
+    return levels.empty() ? nullptr : &levels.begin()->second;
+}
+
+
+/**
+*  @brief Returns resting order, nullptr if it was filled or cancelled
+*/
+const Order* LimitOrderBook::getOrder(OrderHandle handle) const {
+    uint32_t node = findNode(handle);
+    return node != NIL ? &nodes[node].order : nullptr;
+}
+
+
+/**
+*  @brief Returns best bid or ask price, zero if the side is empty
+*/
+Money LimitOrderBook::getBestPrice(ProductIndex product, OrderSide side) const {
+    const PriceLevel* level = bestLevel(product, side);
+    return level != nullptr ? level->price : Money(0);
+}
+
+
+Quantity LimitOrderBook::getBestQuantity(ProductIndex product, OrderSide side) const {
+    const PriceLevel* level = bestLevel(product, side);
+    return level != nullptr ? level->quantity : 0;
+}
+
+
+/**
+*  @brief Returns unfilled quantity of resting order, zero if it was filled or cancelled
+*/
+Quantity LimitOrderBook::getRestingQuantity(OrderHandle handle) const {
+    const Order* order = getOrder(handle);
+    return order != nullptr ? order->quantity : 0;
+}
+
+
+/**
+*  @brief Returns total quantity of resting bids or asks of product
+*/
+Quantity LimitOrderBook::getOpenQuantity(ProductIndex product, OrderSide side) const {
+    if (product >= books.size()) return 0;
+    return side == OrderSide::Buy ? books[product].bidQuantity : books[product].askQuantity;
+}
+
+
+size_t LimitOrderBook::getLevelsCount(ProductIndex product, OrderSide side) const {
+    if (product >= books.size()) return 0;
+    return side == OrderSide::Buy ? books[product].bids.size() : books[product].asks.size();
+}
+
+
+size_t LimitOrderBook::getOrdersCount() const {
+    return ordersCount;
+}
@@ -0,0 +1,271 @@
+/**
+ * =============================================================================
+ *
+ * @class PriceHistory
+ * @brief Fixed-capacity history of market data of all products with rolling
+ *        statistics.
+ *
+ * Every recorded tick appends one row of price, cost, demand, supply and
+ * cleared volume of all products to ring buffers of K rows. Rows are padded
+ * to cache lines, so recording a tick is a sequential write of every field.
+ * Agents and clients read market data as of any lag up to K - 1 ticks
+ * directly from the buffers, nothing is copied per reader.
+ *
+ * Rolling statistics are running sums over the window updated in O(1) per
+ * product and tick: the leaving row is subtracted before it is overwritten.
+ *  - mean        arithmetic mean of prices
+ *  - EMA         exponential moving average of prices
+ *  - VWAP        volume weighted average price, mean if nothing was traded
+ *  - volatility  standard deviation of tick to tick relative price changes
+ * Running sums are recomputed from the buffers once per K ticks, so
+ * floating-point drift does not accumulate (amortized O(1)).
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+
+using namespace Axionomy;
+
+
+namespace {
+
+    constexpr size_t LINE_VALUES = CacheAlignedAllocator<double>::alignment / sizeof(double);
+
+    // Relative price change, zero for a product without price
+    inline double relativeChange(Price previous, Price current) {
+        return previous != 0 ? current / previous - 1.0 : 0.0;
+    }
+
+}
+
+
+/**
+*  @brief Creates empty history
+*  @param capacity number of last ticks kept, at least two
+*/
+PriceHistory::PriceHistory(size_t capacity) :
+    capacity(std::max<size_t>(capacity, 2)), smoothing(2.0 / (double(this->capacity) + 1.0)) {}
+
+
+/**
+*  @brief Drops recorded ticks and sizes buffers for products count
+*  @param productsCount number of products
+*/
+void PriceHistory::reset(size_t productsCount) {
+    this->productsCount = productsCount;
+    stride = (productsCount + LINE_VALUES - 1) / LINE_VALUES * LINE_VALUES;
+    ticksCount = 0;
+    for (auto* buffer : { &prices, &costs, &demands, &supplies, &volumes }) buffer->assign(capacity * stride, 0);
+    for (auto* sums : { &priceSum, &valueSum, &volumeSum, &returnSum, &returnSquares, &ema }) sums->assign(stride, 0);
+}
+
+
+/**
+*  @brief Moves history of retained products to their new dense indices after
+*         catalog reload, added products get flat history of current state
+*  @param diff reload result with old to new index remap
+*  @param state products state of the new catalog
+*/
+void PriceHistory::remap(const ProductsDiff& diff, const ProductsState& state) {
+    PriceHistory remapped(capacity);
+    remapped.smoothing = smoothing;
+    remapped.reset(state.size());
+    remapped.ticksCount = ticksCount;
+    size_t depth = getDepth();
+
+    std::vector<bool> retained(state.size(), false);
+    for (size_t oldIndex = 0; oldIndex < diff.remap.size(); oldIndex++) {
+        size_t index = diff.remap[oldIndex];
+        if (index == NOT_FOUND) continue;
+        retained[index] = true;
+        for (size_t row = 0; row < capacity; row++) {
+            remapped.prices[row * remapped.stride + index] = prices[row * stride + oldIndex];
+            remapped.costs[row * remapped.stride + index] = costs[row * stride + oldIndex];
+            remapped.demands[row * remapped.stride + index] = demands[row * stride + oldIndex];
+            remapped.supplies[row * remapped.stride + index] = supplies[row * stride + oldIndex];
+            remapped.volumes[row * remapped.stride + index] = volumes[row * stride + oldIndex];
+        }
+        remapped.ema[index] = ema[oldIndex];
+    }
+    for (size_t index = 0; index < state.size(); index++) {
+        if (retained[index]) continue;
+        for (size_t lag = 0; lag < depth; lag++) {
+            size_t row = remapped.slot(lag) * remapped.stride + index;
+            remapped.prices[row] = state.price[index];
+            remapped.costs[row] = state.cost[index];
+            remapped.demands[row] = state.demand[index];
+            remapped.supplies[row] = state.supply[index];
+        }
+        remapped.ema[index] = state.price[index];
+    }
+
+    remapped.recomputeStatistics();
+    *this = std::move(remapped);
+}
+
+
+/**
+*  @brief Appends market data of the tick and updates rolling statistics
+*  @param state products state after pricing
+*  @param volume cleared quantities by dense index, nullptr if nothing was traded
+*/
+void PriceHistory::record(const ProductsState& state, const Quantity* volume) {
+    if (state.size() != productsCount) reset(state.size());
+
+    const size_t row = (ticksCount % capacity) * stride;
+    const size_t previousRow = ((ticksCount + capacity - 1) % capacity) * stride;
+    const size_t nextRow = ((ticksCount + 1) % capacity) * stride;
+    const bool full = ticksCount >= capacity;
+    const bool first = ticksCount == 0;
+
+    for (size_t i = 0; i < productsCount; i++) {
+        const Price price = state.price[i];
+        const Quantity traded = volume != nullptr ? volume[i] : 0;
+
+        // Oldest tick leaves the window: its price, value and change to the next tick
+        if (full) {
+            const Price oldPrice = prices[row + i];
+            const Quantity oldVolume = volumes[row + i];
+            const double oldChange = relativeChange(oldPrice, prices[nextRow + i]);
+            priceSum[i] -= oldPrice;
+            valueSum[i] -= oldPrice * oldVolume;
+            volumeSum[i] -= oldVolume;
+            returnSum[i] -= oldChange;
+            returnSquares[i] -= oldChange * oldChange;
+        }
+
+        // New tick enters the window
+        if (!first) {
+            const double change = relativeChange(prices[previousRow + i], price);
+            returnSum[i] += change;
+            returnSquares[i] += change * change;
+        }
+        priceSum[i] += price;
+        valueSum[i] += price * traded;
+        volumeSum[i] += traded;
+        ema[i] = first ? price : ema[i] + smoothing * (price - ema[i]);
+
+        prices[row + i] = price;
+        costs[row + i] = state.cost[i];
+        demands[row + i] = state.demand[i];
+        supplies[row + i] = state.supply[i];
+        volumes[row + i] = traded;
+    }
+
+    ticksCount++;
+    if (ticksCount % capacity == 0) recomputeStatistics();
+}
+
+
+/**
+*  @brief Sets EMA smoothing factor, 2 / (K + 1) by default
+*/
+void PriceHistory::setSmoothing(double alpha) {
+    smoothing = std::clamp(alpha, 0.0, 1.0);
+}
+
+
+size_t PriceHistory::getCapacity() const {
+    return capacity;
+}
+
+
+/**
+*  @brief Returns number of ticks available in the window
+*/
+size_t PriceHistory::getDepth() const {
+    return std::min(ticksCount, capacity);
+}
+
+
+size_t PriceHistory::getTicksCount() const {
+    return ticksCount;
+}
+
+
+/**
+*  @brief Returns ring buffer row of the tick lag ticks ago, lag is limited by depth
+*/
+size_t PriceHistory::slot(size_t lag) const {
+    lag = std::min(lag, std::max<size_t>(getDepth(), 1) - 1);
+    return (ticksCount + capacity - 1 - lag) % capacity;
+}
+
+
+Price PriceHistory::getPrice(ProductIndex product, size_t lag) const {
+    return prices[slot(lag) * stride + product];
+}
+
+
+Price PriceHistory::getCost(ProductIndex product, size_t lag) const {
+    return costs[slot(lag) * stride + product];
+}
+
+
+Quantity PriceHistory::getDemand(ProductIndex product, size_t lag) const {
+    return demands[slot(lag) * stride + product];
+}
+
+
+Quantity PriceHistory::getSupply(ProductIndex product, size_t lag) const {
+    return supplies[slot(lag) * stride + product];
+}
+
+
+Quantity PriceHistory::getVolume(ProductIndex product, size_t lag) const {
+    return volumes[slot(lag) * stride + product];
+}
+
+
+Price PriceHistory::getMean(ProductIndex product) const {
+    size_t depth = getDepth();
+    return depth > 0 ? priceSum[product] / double(depth) : 0;
+}
+
+
+Price PriceHistory::getEMA(ProductIndex product) const {
+    return ema[product];
+}
+
+
+Price PriceHistory::getVWAP(ProductIndex product) const {
+    return volumeSum[product] > 0 ? valueSum[product] / volumeSum[product] : getMean(product);
+}
+
+
+double PriceHistory::getVolatility(ProductIndex product) const {
+    size_t changes = getDepth() > 1 ? getDepth() - 1 : 0;
+    if (changes == 0) return 0;
+    double mean = returnSum[product] / double(changes);
+    return std::sqrt(std::max(0.0, returnSquares[product] / double(changes) - mean * mean));
+}
+
+
+/**
+*  @brief Recomputes running sums from buffers, removes accumulated rounding
+*/
+void PriceHistory::recomputeStatistics() {
+    size_t depth = getDepth();
+    std::fill(priceSum.begin(), priceSum.end(), 0);
+    std::fill(valueSum.begin(), valueSum.end(), 0);
+    std::fill(volumeSum.begin(), volumeSum.end(), 0);
+    std::fill(returnSum.begin(), returnSum.end(), 0);
+    std::fill(returnSquares.begin(), returnSquares.end(), 0);
+    // Oldest to latest, row by row
+    for (size_t lag = depth; lag-- > 0;) {
+        size_t row = slot(lag) * stride;
+        size_t previousRow = slot(lag + 1) * stride;
+        for (size_t i = 0; i < productsCount; i++) {
+            priceSum[i] += prices[row + i];
+            valueSum[i] += prices[row + i] * volumes[row + i];
+            volumeSum[i] += volumes[row + i];
+            if (lag + 1 < depth) {
+                double change = relativeChange(prices[previousRow + i], prices[row + i]);
+                returnSum[i] += change;
+                returnSquares[i] += change * change;
+            }
+        }
+    }
+}
@@ -0,0 +1,628 @@
+/**
+ * =============================================================================
+ *
+ * @class PricingKernels
+ * @brief Batch evaluation of demand/supply price multipliers.
+ *
+ * The price multiplier is the asymmetric sigmoid of the demand/supply
+ * imbalance. It does not depend on costs, so it is evaluated for all products
+ * at once before the topological cost and price pass. This is where the
+ * transcendental functions (exp, pow) of the pricing model are spent.
+ *
+ * Kernels:
+ *  - Scalar  libm std::exp / std::pow, reference results.
+ *  - AVX2    4 doubles per step, vectorized exp/log with FMA.
+ *  - AVX512  8 doubles per step, vectorized exp/log.
+ *
+ * pow(1 + e, v) is evaluated as exp(v * log(1 + e)). Vector exp uses a
+ * degree 12 polynomial after ln2 range reduction and vector log uses the
+ * atanh series on the mantissa in [sqrt(0.5), sqrt(2)), both accurate to a
+ * few ulp, so vector multipliers stay within PricingKernels::tolerance
+ * (relative) of the scalar kernel.
+ *
+ * Precision (PricingPrecision), the sigmoid is templated on number type and
+ * math policy:
+ *  - Double     double lanes, libm or degree 12 polynomials (reference).
+ *  - Float      float lanes, libm float functions or polynomials accurate to
+ *               float rounding, twice as many lanes per vector.
+ *  - FastFloat  float lanes, short polynomials with bounded error.
+ * Inputs and outputs are double arrays in every mode, float kernels convert
+ * at load and store. PricingKernels::getTolerance reports the bound of each
+ * mode relative to the double scalar kernel.
+ *
+ * The best kernel supported by the CPU is detected at runtime, the binary
+ * does not require AVX to run.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+#include <bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AXIONOMY_X86_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define AXIONOMY_TARGET(features)
+#else
+#define AXIONOMY_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+
+using namespace Axionomy;
+
+
+namespace {
+
+    // disbalance sensitivity (maximum 1% deficit adds 10% to price)
+    constexpr double maxElasticity = 12.305019857643899;
+
+    // sigmoid asymmetry parameters
+    constexpr double minY = 0.4; // minimal price multiplier
+    constexpr double maxY = 4.0; // maximum price multiplier
+    constexpr double diff = maxY - minY;
+    const double v = std::log2((maxY - minY) / (1 - minY));
+
+    // Division-by-zero protection (bias)
+    constexpr double bias = 0.001;
+
+    // Maximum relative deviation of float modes from the double scalar kernel
+    constexpr double floatTolerance = 1e-5;
+    constexpr double fastFloatTolerance = 5e-5;
+
+
+    //-------------------------------------------------------------------------
+    // Float polynomial math policies: exp after ln2 range reduction (1/k!
+    // coefficients) and log as atanh series on the mantissa in
+    // [sqrt(0.5), sqrt(2)) (1/(2k+1) coefficients), Horner order
+    //-------------------------------------------------------------------------
+    struct AccuratePolynomials {                      // below float rounding
+        static constexpr float expCoefficients[] = {
+            1.0f / 5040, 1.0f / 720, 1.0f / 120, 1.0f / 24, 1.0f / 6, 0.5f, 1.0f, 1.0f
+        };
+        static constexpr float logCoefficients[] = { 1.0f / 9, 1.0f / 7, 1.0f / 5, 1.0f / 3, 1.0f };
+    };
+
+    struct FastPolynomials {                          // about 3e-6 relative
+        static constexpr float expCoefficients[] = { 1.0f / 120, 1.0f / 24, 1.0f / 6, 0.5f, 1.0f, 1.0f };
+        static constexpr float logCoefficients[] = { 1.0f / 5, 1.0f / 3, 1.0f };
+    };
+
+    constexpr float log2eFloat = 1.44269504f;
+    constexpr float ln2HiFloat = 0.693359375f;        // exact in float, ln2 = ln2Hi + ln2Lo
+    constexpr float ln2LoFloat = -2.12194440e-4f;
+    constexpr float ln2Float = 0.693147181f;
+    constexpr float sqrt2Float = 1.41421356f;
+    constexpr float expMinFloat = -87.0f;
+    constexpr float expMaxFloat = 88.0f;
+    constexpr int32_t exponentBiasFloat = 127;
+    constexpr int32_t mantissaMaskFloat = 0x007FFFFF;
+    constexpr int32_t oneBitsFloat = 0x3F800000;
+    constexpr float roundingMagic = 12582912.0f;      // 1.5 * 2^23, rounds small floats to nearest integer
+
+
+    //-------------------------------------------------------------------------
+    // Scalar math policies
+    //-------------------------------------------------------------------------
+    template <typename Real>
+    struct LibmMath {
+        static Real exp(Real x) { return std::exp(x); }
+        static Real pow(Real x, Real y) { return std::pow(x, y); }
+    };
+
+    template <class Polynomials>
+    struct PolynomialMath {
+        static float exp(float x) {
+            // Branch-free: random market data makes branches unpredictable
+            x = std::min(std::max(x, expMinFloat), expMaxFloat);
+            float n = (x * log2eFloat + roundingMagic) - roundingMagic;
+            float r = x - n * ln2HiFloat - n * ln2LoFloat;
+            float p = Polynomials::expCoefficients[0];
+            for (size_t i = 1; i < std::size(Polynomials::expCoefficients); i++) p = p * r + Polynomials::expCoefficients[i];
+            return p * std::bit_cast<float>((int32_t(n) + exponentBiasFloat) << 23);
+        }
+        static float log(float y) {                   // y must be positive and normal
+            int32_t bits = std::bit_cast<int32_t>(y);
+            float k = float((bits >> 23) - exponentBiasFloat);
+            float m = std::bit_cast<float>((bits & mantissaMaskFloat) | oneBitsFloat);
+            float large = float(m > sqrt2Float);
+            m *= 1.0f - 0.5f * large;
+            k += large;
+            float s = (m - 1.0f) / (m + 1.0f);
+            float z = s * s;
+            float p = Polynomials::logCoefficients[0];
+            for (size_t i = 1; i < std::size(Polynomials::logCoefficients); i++) p = p * z + Polynomials::logCoefficients[i];
+            return k * ln2Float + 2.0f * s * p;
+        }
+        static float pow(float x, float y) { return exp(y * log(x)); }
+    };
+
+
+    /**
+    *  @brief Asymmetric sigmoid of demand/supply imbalance
+    *  @tparam Real number type of evaluation
+    *  @tparam Math exp and pow functions
+    */
+    template <typename Real, class Math>
+    Real evaluateSigmoid(Real demand, Real supply, Real importance) {
+
+        Real k = importance * Real(maxElasticity);
+
+        // measure disbalance and ratio
+        Real balanceAmount = demand - supply;
+        Real balanceRatio = balanceAmount / (supply + Real(bias));
+
+        // evaluate asymmetric sigmoid [min, max)
+        Real e = Math::exp(-balanceRatio * k);
+        Real sigmoid = Real(minY) + (Real(diff) / Math::pow(1 + e, Real(v)));
+
+        return std::clamp(sigmoid, Real(minY), Real(maxY));
+    }
+
+    template <typename Real, class Math>
+    void evaluateMultipliersScalar(const Quantity* demand, const Quantity* supply, const double* importance, double* multiplier, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            multiplier[i] = evaluateSigmoid<Real, Math>(Real(demand[i]), Real(supply[i]), Real(importance[i]));
+        }
+    }
+
+
+#if defined(AXIONOMY_X86_KERNELS)
+
+    // Range reduction and polynomial constants shared by vector kernels
+    constexpr double log2e = 1.4426950408889634;
+    constexpr double ln2Hi = 0.693147180369123816490;
+    constexpr double ln2Lo = 1.90821492927058770002e-10;
+    constexpr double ln2 = 0.6931471805599453;
+    constexpr double sqrt2 = 1.4142135623730951;
+    constexpr double expMin = -708.0;
+    constexpr double expMax = 709.0;
+    constexpr int64_t exponentBias = 1023;
+    constexpr int64_t mantissaMask = 0x000FFFFFFFFFFFFFLL;
+    constexpr int64_t oneBits = 0x3FF0000000000000LL;
+    constexpr int64_t magicBits = 0x4330000000000000LL;   // 2^52, converts small integers to double
+    constexpr double magic = 4503599627370496.0;
+
+    // 1/k! for k = 12..0, Horner order
+    constexpr double expCoefficients[] = {
+        2.08767569878680989792e-09, 2.50521083854417187751e-08, 2.75573192239858906526e-07,
+        2.75573192239858906526e-06, 2.48015873015873015873e-05, 1.98412698412698412698e-04,
+        1.38888888888888888889e-03, 8.33333333333333333333e-03, 4.16666666666666666667e-02,
+        1.66666666666666666667e-01, 0.5, 1.0, 1.0
+    };
+
+    // 1/(2k+1) for k = 10..0, Horner order of atanh series in z = s^2
+    constexpr double logCoefficients[] = {
+        1.0 / 21, 1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11,
+        1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3, 1.0
+    };
+
+
+    //-------------------------------------------------------------------------
+    // AVX2 + FMA kernel, 4 lanes
+    //-------------------------------------------------------------------------
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256d exp256(__m256d x) {
+        x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(expMin)), _mm256_set1_pd(expMax));
+        __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2Hi), x);
+        r = _mm256_fnmadd_pd(n, _mm256_set1_pd(ln2Lo), r);
+        __m256d p = _mm256_set1_pd(expCoefficients[0]);
+        for (size_t i = 1; i < std::size(expCoefficients); i++) {
+            p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(expCoefficients[i]));
+        }
+        __m256i exponent = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+        exponent = _mm256_slli_epi64(_mm256_add_epi64(exponent, _mm256_set1_epi64x(exponentBias)), 52);
+        return _mm256_mul_pd(p, _mm256_castsi256_pd(exponent));
+    }
+
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256d log256(__m256d y) {                                  // y must be positive and normal
+        __m256i bits = _mm256_castpd_si256(y);
+        __m256i exponentBits = _mm256_srli_epi64(bits, 52);
+        __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(exponentBits, _mm256_set1_epi64x(magicBits))),
+            _mm256_set1_pd(magic + double(exponentBias)));
+        __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(mantissaMask)),
+            _mm256_set1_epi64x(oneBits)));
+        __m256d large = _mm256_cmp_pd(m, _mm256_set1_pd(sqrt2), _CMP_GT_OQ);
+        m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), large);
+        k = _mm256_add_pd(k, _mm256_and_pd(large, _mm256_set1_pd(1.0)));
+        __m256d s = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)), _mm256_add_pd(m, _mm256_set1_pd(1.0)));
+        __m256d z = _mm256_mul_pd(s, s);
+        __m256d p = _mm256_set1_pd(logCoefficients[0]);
+        for (size_t i = 1; i < std::size(logCoefficients); i++) {
+            p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(logCoefficients[i]));
+        }
+        return _mm256_fmadd_pd(k, _mm256_set1_pd(ln2), _mm256_mul_pd(_mm256_add_pd(s, s), p));
+    }
+
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256d multiplier256(__m256d demand, __m256d supply, __m256d importance) {
+        __m256d k = _mm256_mul_pd(importance, _mm256_set1_pd(maxElasticity));
+        __m256d ratio = _mm256_div_pd(_mm256_sub_pd(demand, supply), _mm256_add_pd(supply, _mm256_set1_pd(bias)));
+        __m256d e = exp256(_mm256_mul_pd(_mm256_xor_pd(ratio, _mm256_set1_pd(-0.0)), k));
+        __m256d power = exp256(_mm256_mul_pd(_mm256_set1_pd(-v), log256(_mm256_add_pd(e, _mm256_set1_pd(1.0)))));
+        __m256d sigmoid = _mm256_fmadd_pd(_mm256_set1_pd(diff), power, _mm256_set1_pd(minY));
+        return _mm256_min_pd(_mm256_max_pd(sigmoid, _mm256_set1_pd(minY)), _mm256_set1_pd(maxY));
+    }
+
+    AXIONOMY_TARGET("avx2,fma")
+    void evaluateMultipliersAVX2(const Quantity* demand, const Quantity* supply, const double* importance, double* multiplier, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d result = multiplier256(_mm256_loadu_pd(demand + i), _mm256_loadu_pd(supply + i), _mm256_loadu_pd(importance + i));
+            _mm256_storeu_pd(multiplier + i, result);
+        }
+        if (i == count) return;
+        // Tail goes through the same vector code on padded copies
+        alignas(32) double d[4] = { 0 }, s[4] = { 0 }, w[4] = { 0 }, m[4];
+        std::copy(demand + i, demand + count, d);
+        std::copy(supply + i, supply + count, s);
+        std::copy(importance + i, importance + count, w);
+        _mm256_store_pd(m, multiplier256(_mm256_load_pd(d), _mm256_load_pd(s), _mm256_load_pd(w)));
+        std::copy(m, m + (count - i), multiplier + i);
+    }
+
+
+    //-------------------------------------------------------------------------
+    // AVX2 + FMA float kernel, 8 lanes
+    //-------------------------------------------------------------------------
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256 exp256f(__m256 x) {
+        x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(expMinFloat)), _mm256_set1_ps(expMaxFloat));
+        __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(log2eFloat)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2HiFloat), x);
+        r = _mm256_fnmadd_ps(n, _mm256_set1_ps(ln2LoFloat), r);
+        __m256 p = _mm256_set1_ps(Polynomials::expCoefficients[0]);
+        for (size_t i = 1; i < std::size(Polynomials::expCoefficients); i++) {
+            p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(Polynomials::expCoefficients[i]));
+        }
+        __m256i exponent = _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(exponentBiasFloat));
+        return _mm256_mul_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(exponent, 23)));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256 log256f(__m256 y) {                                   // y must be positive and normal
+        __m256i bits = _mm256_castps_si256(y);
+        __m256 k = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(exponentBiasFloat)));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(mantissaMaskFloat)),
+            _mm256_set1_epi32(oneBitsFloat)));
+        __m256 large = _mm256_cmp_ps(m, _mm256_set1_ps(sqrt2Float), _CMP_GT_OQ);
+        m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), large);
+        k = _mm256_add_ps(k, _mm256_and_ps(large, _mm256_set1_ps(1.0f)));
+        __m256 s = _mm256_div_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)), _mm256_add_ps(m, _mm256_set1_ps(1.0f)));
+        __m256 z = _mm256_mul_ps(s, s);
+        __m256 p = _mm256_set1_ps(Polynomials::logCoefficients[0]);
+        for (size_t i = 1; i < std::size(Polynomials::logCoefficients); i++) {
+            p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(Polynomials::logCoefficients[i]));
+        }
+        return _mm256_fmadd_ps(k, _mm256_set1_ps(ln2Float), _mm256_mul_ps(_mm256_add_ps(s, s), p));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256 multiplier256f(__m256 demand, __m256 supply, __m256 importance) {
+        __m256 k = _mm256_mul_ps(importance, _mm256_set1_ps(float(maxElasticity)));
+        __m256 ratio = _mm256_div_ps(_mm256_sub_ps(demand, supply), _mm256_add_ps(supply, _mm256_set1_ps(float(bias))));
+        __m256 e = exp256f<Polynomials>(_mm256_mul_ps(_mm256_xor_ps(ratio, _mm256_set1_ps(-0.0f)), k));
+        __m256 logarithm = log256f<Polynomials>(_mm256_add_ps(e, _mm256_set1_ps(1.0f)));
+        __m256 power = exp256f<Polynomials>(_mm256_mul_ps(_mm256_set1_ps(float(-v)), logarithm));
+        __m256 sigmoid = _mm256_fmadd_ps(_mm256_set1_ps(float(diff)), power, _mm256_set1_ps(float(minY)));
+        return _mm256_min_ps(_mm256_max_ps(sigmoid, _mm256_set1_ps(float(minY))), _mm256_set1_ps(float(maxY)));
+    }
+
+    AXIONOMY_TARGET("avx2,fma")
+    inline __m256 load256f(const double* source) {
+        return _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(source + 4)), _mm256_cvtpd_ps(_mm256_loadu_pd(source)));
+    }
+
+    AXIONOMY_TARGET("avx2,fma")
+    inline void store256f(double* target, __m256 value) {
+        _mm256_storeu_pd(target, _mm256_cvtps_pd(_mm256_castps256_ps128(value)));
+        _mm256_storeu_pd(target + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(value, 1)));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx2,fma")
+    void evaluateMultipliersAVX2Float(const Quantity* demand, const Quantity* supply, const double* importance, double* multiplier, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            store256f(multiplier + i, multiplier256f<Polynomials>(load256f(demand + i), load256f(supply + i), load256f(importance + i)));
+        }
+        if (i == count) return;
+        // Tail goes through the same vector code on padded copies
+        alignas(32) double d[8] = { 0 }, s[8] = { 0 }, w[8] = { 0 }, m[8];
+        std::copy(demand + i, demand + count, d);
+        std::copy(supply + i, supply + count, s);
+        std::copy(importance + i, importance + count, w);
+        store256f(m, multiplier256f<Polynomials>(load256f(d), load256f(s), load256f(w)));
+        std::copy(m, m + (count - i), multiplier + i);
+    }
+
+
+    //-------------------------------------------------------------------------
+    // AVX-512F kernel, 8 lanes
+    //-------------------------------------------------------------------------
+    // Unmasked AVX-512 intrinsics of GCC 12 pass an undefined source, which
+    // -Wmaybe-uninitialized reports, so full-width operations use zero masking
+    constexpr __mmask8 lanes4 = 0x0F;
+    constexpr __mmask8 lanes8 = 0xFF;
+    constexpr __mmask16 lanes16 = 0xFFFF;
+
+    AXIONOMY_TARGET("avx512f")
+    inline __m512d exp512(__m512d x) {
+        x = _mm512_maskz_min_pd(lanes8, _mm512_maskz_max_pd(lanes8, x, _mm512_set1_pd(expMin)), _mm512_set1_pd(expMax));
+        __m512d n = _mm512_maskz_roundscale_pd(lanes8, _mm512_mul_pd(x, _mm512_set1_pd(log2e)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2Hi), x);
+        r = _mm512_fnmadd_pd(n, _mm512_set1_pd(ln2Lo), r);
+        __m512d p = _mm512_set1_pd(expCoefficients[0]);
+        for (size_t i = 1; i < std::size(expCoefficients); i++) {
+            p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(expCoefficients[i]));
+        }
+        __m512i exponent = _mm512_maskz_cvtepi32_epi64(lanes8, _mm512_maskz_cvtpd_epi32(lanes8, n));
+        exponent = _mm512_maskz_slli_epi64(lanes8, _mm512_add_epi64(exponent, _mm512_set1_epi64(exponentBias)), 52);
+        return _mm512_mul_pd(p, _mm512_castsi512_pd(exponent));
+    }
+
+    AXIONOMY_TARGET("avx512f")
+    inline __m512d log512(__m512d y) {                                  // y must be positive and normal
+        __m512i bits = _mm512_castpd_si512(y);
+        __m512i exponentBits = _mm512_maskz_srli_epi64(lanes8, bits, 52);
+        __m512d k = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(exponentBits, _mm512_set1_epi64(magicBits))),
+            _mm512_set1_pd(magic + double(exponentBias)));
+        __m512d m = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi64(mantissaMask)),
+            _mm512_set1_epi64(oneBits)));
+        __mmask8 large = _mm512_cmp_pd_mask(m, _mm512_set1_pd(sqrt2), _CMP_GT_OQ);
+        m = _mm512_mask_mul_pd(m, large, m, _mm512_set1_pd(0.5));
+        k = _mm512_mask_add_pd(k, large, k, _mm512_set1_pd(1.0));
+        __m512d s = _mm512_div_pd(_mm512_sub_pd(m, _mm512_set1_pd(1.0)), _mm512_add_pd(m, _mm512_set1_pd(1.0)));
+        __m512d z = _mm512_mul_pd(s, s);
+        __m512d p = _mm512_set1_pd(logCoefficients[0]);
+        for (size_t i = 1; i < std::size(logCoefficients); i++) {
+            p = _mm512_fmadd_pd(p, z, _mm512_set1_pd(logCoefficients[i]));
+        }
+        return _mm512_fmadd_pd(k, _mm512_set1_pd(ln2), _mm512_mul_pd(_mm512_add_pd(s, s), p));
+    }
+
+    AXIONOMY_TARGET("avx512f")
+    inline __m512d multiplier512(__m512d demand, __m512d supply, __m512d importance) {
+        __m512d k = _mm512_mul_pd(importance, _mm512_set1_pd(maxElasticity));
+        __m512d ratio = _mm512_div_pd(_mm512_sub_pd(demand, supply), _mm512_add_pd(supply, _mm512_set1_pd(bias)));
+        __m512d e = exp512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), ratio), k));
+        __m512d power = exp512(_mm512_mul_pd(_mm512_set1_pd(-v), log512(_mm512_add_pd(e, _mm512_set1_pd(1.0)))));
+        __m512d sigmoid = _mm512_fmadd_pd(_mm512_set1_pd(diff), power, _mm512_set1_pd(minY));
+        return _mm512_maskz_min_pd(lanes8, _mm512_maskz_max_pd(lanes8, sigmoid, _mm512_set1_pd(minY)), _mm512_set1_pd(maxY));
+    }
+
+    AXIONOMY_TARGET("avx512f")
+    void evaluateMultipliersAVX512(const Quantity* demand, const Quantity* supply, const double* importance, double* multiplier, size_t count) {
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m512d result = multiplier512(_mm512_loadu_pd(demand + i), _mm512_loadu_pd(supply + i), _mm512_loadu_pd(importance + i));
+            _mm512_storeu_pd(multiplier + i, result);
+        }
+        if (i == count) return;
+        // Tail is processed with masked loads and stores
+        __mmask8 tail = __mmask8((1u << (count - i)) - 1);
+        __m512d one = _mm512_set1_pd(1.0);
+        __m512d result = multiplier512(_mm512_mask_loadu_pd(_mm512_setzero_pd(), tail, demand + i),
+            _mm512_mask_loadu_pd(one, tail, supply + i), _mm512_mask_loadu_pd(_mm512_setzero_pd(), tail, importance + i));
+        _mm512_mask_storeu_pd(multiplier + i, tail, result);
+    }
+
+
+    //-------------------------------------------------------------------------
+    // AVX-512F float kernel, 16 lanes
+    //-------------------------------------------------------------------------
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx512f")
+    inline __m512 exp512f(__m512 x) {
+        x = _mm512_maskz_min_ps(lanes16, _mm512_maskz_max_ps(lanes16, x, _mm512_set1_ps(expMinFloat)), _mm512_set1_ps(expMaxFloat));
+        __m512 n = _mm512_maskz_roundscale_ps(lanes16, _mm512_mul_ps(x, _mm512_set1_ps(log2eFloat)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2HiFloat), x);
+        r = _mm512_fnmadd_ps(n, _mm512_set1_ps(ln2LoFloat), r);
+        __m512 p = _mm512_set1_ps(Polynomials::expCoefficients[0]);
+        for (size_t i = 1; i < std::size(Polynomials::expCoefficients); i++) {
+            p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(Polynomials::expCoefficients[i]));
+        }
+        __m512i exponent = _mm512_add_epi32(_mm512_maskz_cvtps_epi32(lanes16, n), _mm512_set1_epi32(exponentBiasFloat));
+        return _mm512_mul_ps(p, _mm512_castsi512_ps(_mm512_maskz_slli_epi32(lanes16, exponent, 23)));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx512f")
+    inline __m512 log512f(__m512 y) {                                   // y must be positive and normal
+        __m512i bits = _mm512_castps_si512(y);
+        __m512 k = _mm512_maskz_cvtepi32_ps(lanes16, _mm512_sub_epi32(_mm512_maskz_srli_epi32(lanes16, bits, 23), _mm512_set1_epi32(exponentBiasFloat)));
+        __m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(mantissaMaskFloat)),
+            _mm512_set1_epi32(oneBitsFloat)));
+        __mmask16 large = _mm512_cmp_ps_mask(m, _mm512_set1_ps(sqrt2Float), _CMP_GT_OQ);
+        m = _mm512_mask_mul_ps(m, large, m, _mm512_set1_ps(0.5f));
+        k = _mm512_mask_add_ps(k, large, k, _mm512_set1_ps(1.0f));
+        __m512 s = _mm512_div_ps(_mm512_sub_ps(m, _mm512_set1_ps(1.0f)), _mm512_add_ps(m, _mm512_set1_ps(1.0f)));
+        __m512 z = _mm512_mul_ps(s, s);
+        __m512 p = _mm512_set1_ps(Polynomials::logCoefficients[0]);
+        for (size_t i = 1; i < std::size(Polynomials::logCoefficients); i++) {
+            p = _mm512_fmadd_ps(p, z, _mm512_set1_ps(Polynomials::logCoefficients[i]));
+        }
+        return _mm512_fmadd_ps(k, _mm512_set1_ps(ln2Float), _mm512_mul_ps(_mm512_add_ps(s, s), p));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx512f")
+    inline __m512 multiplier512f(__m512 demand, __m512 supply, __m512 importance) {
+        __m512 k = _mm512_mul_ps(importance, _mm512_set1_ps(float(maxElasticity)));
+        __m512 ratio = _mm512_div_ps(_mm512_sub_ps(demand, supply), _mm512_add_ps(supply, _mm512_set1_ps(float(bias))));
+        __m512 e = exp512f<Polynomials>(_mm512_mul_ps(_mm512_sub_ps(_mm512_setzero_ps(), ratio), k));
+        __m512 logarithm = log512f<Polynomials>(_mm512_add_ps(e, _mm512_set1_ps(1.0f)));
+        __m512 power = exp512f<Polynomials>(_mm512_mul_ps(_mm512_set1_ps(float(-v)), logarithm));
+        __m512 sigmoid = _mm512_fmadd_ps(_mm512_set1_ps(float(diff)), power, _mm512_set1_ps(float(minY)));
+        return _mm512_maskz_min_ps(lanes16, _mm512_maskz_max_ps(lanes16, sigmoid, _mm512_set1_ps(float(minY))), _mm512_set1_ps(float(maxY)));
+    }
+
+    AXIONOMY_TARGET("avx512f")
+    inline __m512 load512f(const double* source, __mmask16 mask, double fill) {
+        __m512d filler = _mm512_set1_pd(fill);
+        __m256 low = _mm512_maskz_cvtpd_ps(0xFF, _mm512_mask_loadu_pd(filler, __mmask8(mask), source));
+        __m256 high = _mm512_maskz_cvtpd_ps(0xFF, _mm512_mask_loadu_pd(filler, __mmask8(mask >> 8), source + 8));
+        return _mm512_castpd_ps(_mm512_maskz_insertf64x4(lanes8, _mm512_castps_pd(_mm512_castps256_ps512(low)), _mm256_castps_pd(high), 1));
+    }
+
+    AXIONOMY_TARGET("avx512f")
+    inline void store512f(double* target, __mmask16 mask, __m512 value) {
+        __m256 low = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(lanes4, _mm512_castps_pd(value), 0));
+        __m256 high = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(lanes4, _mm512_castps_pd(value), 1));
+        _mm512_mask_storeu_pd(target, __mmask8(mask), _mm512_maskz_cvtps_pd(lanes8, low));
+        _mm512_mask_storeu_pd(target + 8, __mmask8(mask >> 8), _mm512_maskz_cvtps_pd(lanes8, high));
+    }
+
+    template <class Polynomials>
+    AXIONOMY_TARGET("avx512f")
+    void evaluateMultipliersAVX512Float(const Quantity* demand, const Quantity* supply, const double* importance, double* multiplier, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m512 result = multiplier512f<Polynomials>(load512f(demand + i, 0xFFFF, 0), load512f(supply + i, 0xFFFF, 1),
+                load512f(importance + i, 0xFFFF, 0));
+            store512f(multiplier + i, 0xFFFF, result);
+        }
+        if (i == count) return;
+        // Tail is processed with masked loads and stores
+        __mmask16 tail = __mmask16((1u << (count - i)) - 1);
+        __m512 result = multiplier512f<Polynomials>(load512f(demand + i, tail, 0), load512f(supply + i, tail, 1),
+            load512f(importance + i, tail, 0));
+        store512f(multiplier + i, tail, result);
+    }
+
+
+    //-------------------------------------------------------------------------
+    // CPU features detection
+    //-------------------------------------------------------------------------
+    bool cpuSupports(PricingKernel kernel) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+        if (!osxsave) return false;
+        unsigned long long xcr0 = _xgetbv(0);
+        __cpuidex(info, 7, 0);
+        if (kernel == PricingKernel::AVX2) {
+            return fma && (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+        }
+        return (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+#else
+        __builtin_cpu_init();
+        if (kernel == PricingKernel::AVX2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return __builtin_cpu_supports("avx512f");
+#endif
+    }
+
+#endif
+
+}
+
+
+
+/**
+*  @brief Maximum relative deviation of precision mode from the double scalar kernel
+*  @param precision multipliers precision
+*  @return relative error bound
+*/
+double PricingKernels::getTolerance(PricingPrecision precision) {
+    if (precision == PricingPrecision::Float) return floatTolerance;
+    if (precision == PricingPrecision::FastFloat) return fastFloatTolerance;
+    return tolerance;
+}
+
+
+/**
+*  @brief Evaluates price multiplier of single product with scalar math
+*  @param demand aggregate demand quantity
+*  @param supply aggregate supply quantity
+*  @param importance aggregate consumer importance
+*  @param precision libm double (reference), libm float or fast float polynomials
+*  @return price multiplier in [minY, maxY]
+*/
+double PricingKernels::evaluateMultiplier(Quantity demand, Quantity supply, double importance, PricingPrecision precision) {
+    if (precision == PricingPrecision::Float) {
+        return evaluateSigmoid<float, LibmMath<float>>(float(demand), float(supply), float(importance));
+    }
+    if (precision == PricingPrecision::FastFloat) {
+        return evaluateSigmoid<float, PolynomialMath<FastPolynomials>>(float(demand), float(supply), float(importance));
+    }
+    return evaluateSigmoid<double, LibmMath<double>>(demand, supply, importance);
+}
+
+
+/**
+*  @brief Checks if kernel can run on the current CPU
+*/
+bool PricingKernels::isSupported(PricingKernel kernel) {
+    if (kernel == PricingKernel::Scalar) return true;
+#if defined(AXIONOMY_X86_KERNELS)
+    static const bool avx2 = cpuSupports(PricingKernel::AVX2);
+    static const bool avx512 = cpuSupports(PricingKernel::AVX512);
+    return kernel == PricingKernel::AVX2 ? avx2 : avx512;
+#else
+    return false;
+#endif
+}
+
+
+/**
+*  @brief Detects the widest kernel supported by the current CPU
+*/
+PricingKernel PricingKernels::detect() {
+    if (isSupported(PricingKernel::AVX512)) return PricingKernel::AVX512;
+    if (isSupported(PricingKernel::AVX2)) return PricingKernel::AVX2;
+    return PricingKernel::Scalar;
+}
+
+
+/**
+*  @brief Evaluates price multipliers of products range
+*  @param kernel kernel to use, must be supported by the CPU
+*  @param demand aggregate demand quantities
+*  @param supply aggregate supply quantities
+*  @param importance aggregate consumer importances
+*  @param multiplier output price multipliers
+*  @param count number of products
+*  @param precision number type and math of evaluation
+*/
+void PricingKernels::evaluateMultipliers(PricingKernel kernel, const Quantity* demand, const Quantity* supply,
+    const double* importance, double* multiplier, size_t count, PricingPrecision precision) {
+#if defined(AXIONOMY_X86_KERNELS)
+    if (kernel == PricingKernel::AVX512) {
+        if (precision == PricingPrecision::Float) {
+            return evaluateMultipliersAVX512Float<AccuratePolynomials>(demand, supply, importance, multiplier, count);
+        }
+        if (precision == PricingPrecision::FastFloat) {
+            return evaluateMultipliersAVX512Float<FastPolynomials>(demand, supply, importance, multiplier, count);
+        }
+        return evaluateMultipliersAVX512(demand, supply, importance, multiplier, count);
+    }
+    if (kernel == PricingKernel::AVX2) {
+        if (precision == PricingPrecision::Float) {
+            return evaluateMultipliersAVX2Float<AccuratePolynomials>(demand, supply, importance, multiplier, count);
+        }
+        if (precision == PricingPrecision::FastFloat) {
+            return evaluateMultipliersAVX2Float<FastPolynomials>(demand, supply, importance, multiplier, count);
+        }
+        return evaluateMultipliersAVX2(demand, supply, importance, multiplier, count);
+    }
+#endif
+    if (precision == PricingPrecision::Float) {
+        return evaluateMultipliersScalar<float, LibmMath<float>>(demand, supply, importance, multiplier, count);
+    }
+    if (precision == PricingPrecision::FastFloat) {
+        return evaluateMultipliersScalar<float, PolynomialMath<FastPolynomials>>(demand, supply, importance, multiplier, count);
+    }
+    evaluateMultipliersScalar<double, LibmMath<double>>(demand, supply, importance, multiplier, count);
+}
@@ -0,0 +1,575 @@
+/**
+ * =============================================================================
+ *
+ * @file ProductsImage.cpp
+ * @brief Compiled binary products catalog (image) writer and loader.
+ *
+ * A products image is a versioned binary snapshot of a products catalog
+ * that is memory mapped at startup instead of parsing JSON text.
+ *
+ * Image layout (little-endian, 8 bytes aligned):
+ *  - ImageHeader    magic, version, flags, section sizes and offsets, checksum
+ *  - ProductRecord  fixed-width numeric product records
+ *  - MaterialRecord flattened bill of materials of all products
+ *  - Level offsets  BoM level boundaries over record indices (linked only)
+ *  - Row offsets    BoM row of every record in the materials (linked only)
+ *  - Inputs         dense record index of every material input (linked only)
+ *  - String table   product names (not null terminated)
+ *
+ * A linked image stores a complete catalog in the order of the linker:
+ * level by level, every product after its inputs, with the compressed sparse
+ * row bill of materials over dense indices. The pricer copies these sections
+ * into its arrays as they are, without relinking, ID lookups or intermediate
+ * Product objects. Catalog shards with inputs in other shards are written
+ * unlinked and are linked after the merge like JSON shards.
+ *
+ * Section counts and record ranges are always bounds checked against the
+ * image size, every record is range checked like a JSON product (importance
+ * and floorMargin in [0, 1], non-negative finite prices, quantities and
+ * turnover), and linked sections are checked to keep every input in a lower
+ * level, so a damaged image is never read out of bounds and never yields an
+ * invalid catalog. The FNV-1a checksum of all bytes after the header detects
+ * any other corruption, it reads the whole file and is verified on request.
+ *
+ * The image holds exactly the data of the JSON catalog, so both
+ * representations are interchangeable: saveProductImage(loadProductList(json))
+ * and saveProductList(loadProductImage(image)) round-trip without loss.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+using namespace Axionomy;
+
+
+namespace {
+
+    constexpr uint64_t IMAGE_MAGIC = 0x31474C5441435841ULL;    // "AXCATLG1"
+    constexpr uint32_t IMAGE_VERSION = 2;                       // Image format version
+    constexpr uint32_t IMAGE_ENDIANNESS = 0x01020304;           // Byte order marker
+    constexpr uint32_t IMAGE_LINKED = 1;                        // Linked order, levels and BoM rows are stored
+
+    struct ImageHeader {
+        uint64_t magic;            // Image magic number
+        uint32_t version;          // Image format version
+        uint32_t endianness;       // Byte order marker
+        uint32_t flags;            // IMAGE_LINKED or zero
+        uint32_t levelsCount;      // Number of BoM levels of a linked image, zero otherwise
+        uint64_t productsCount;    // Number of product records
+        uint64_t materialsCount;   // Number of material records
+        uint64_t stringsSize;      // String table size in bytes
+        uint64_t productsOffset;   // Offset of product records from image start
+        uint64_t materialsOffset;  // Offset of material records from image start
+        uint64_t levelsOffset;     // Offset of level offsets from image start
+        uint64_t rowsOffset;       // Offset of BoM row offsets from image start
+        uint64_t inputsOffset;     // Offset of dense input indices from image start
+        uint64_t stringsOffset;    // Offset of string table from image start
+        uint64_t imageSize;        // Total image size in bytes
+        uint64_t checksum;         // FNV-1a checksum of everything after the header
+    };
+
+    struct ProductRecord {
+        uint64_t productID;        // Product ID
+        uint64_t materialsOffset;  // First material record index
+        uint32_t materialsCount;   // Number of material records
+        uint32_t nameLength;       // Name length in bytes
+        uint64_t nameOffset;       // Name offset in the string table
+        uint16_t type;             // ProductType
+        uint16_t unit;             // ProductUnit
+        uint32_t reserved;         // Padding, always zero
+        double   price;            // Market price
+        double   cost;             // Product cost
+        double   demand;           // Aggregate demand quantity
+        double   supply;           // Aggregate supply quantity
+        double   importance;       // Aggregate consumer importance
+        double   floorMargin;      // Minimal industry margin
+        double   turnover;         // Average turnover duration
+    };
+
+    struct MaterialRecord {
+        uint64_t input;            // Input product ID
+        double   quantity;         // Input quantity
+    };
+
+    static_assert(sizeof(ImageHeader) == 112, "unexpected image header layout");
+    static_assert(sizeof(ProductRecord) == 96, "unexpected product record layout");
+    static_assert(sizeof(MaterialRecord) == 16, "unexpected material record layout");
+
+
+    /**
+    *  @brief FNV-1a checksum over 64-bit words (tail bytes are zero padded)
+    */
+    uint64_t checksum(const uint8_t* data, size_t size) {
+        constexpr uint64_t prime = 0x100000001B3ULL;
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        size_t words = size / sizeof(uint64_t);
+        for (size_t i = 0; i < words; i++) {
+            uint64_t word;
+            std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, data + words * sizeof(uint64_t), size % sizeof(uint64_t));
+        return (hash ^ tail) * prime;
+    }
+
+
+    size_t alignUp(size_t value) {
+        return (value + 7) & ~size_t(7);
+    }
+
+
+    /**
+    *  @class MappedFile
+    *  @brief Read-only memory mapping of a whole file
+    */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile() { close(); }
+
+        bool open(const std::string& path);
+        void close();
+        const uint8_t* data() const { return bytes; }
+        size_t size() const { return length; }
+
+    private:
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+    };
+
+
+#if defined(_WIN32)
+
+    bool MappedFile::open(const std::string& path) {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) { close(); return false; }
+        bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (bytes == nullptr) { close(); return false; }
+        length = size_t(fileSize.QuadPart);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (bytes != nullptr) UnmapViewOfFile(bytes);
+        if (mapping != nullptr) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        bytes = nullptr;
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+        length = 0;
+    }
+
+#else
+
+    bool MappedFile::open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) { ::close(fd); return false; }
+        void* address = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);                                                // mapping keeps its own reference
+        if (address == MAP_FAILED) return false;
+        bytes = static_cast<const uint8_t*>(address);
+        length = size_t(info.st_size);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (bytes != nullptr) munmap(const_cast<uint8_t*>(bytes), length);
+        bytes = nullptr;
+        length = 0;
+    }
+
+#endif
+
+
+    /**
+    *  @brief Places image sections one after another from the counts of the header
+    *  @param header image header with counts and flags, offsets and image size are set
+    */
+    void layoutSections(ImageHeader& header) {
+        bool linked = (header.flags & IMAGE_LINKED) != 0;
+        header.productsOffset = sizeof(ImageHeader);
+        header.materialsOffset = header.productsOffset + header.productsCount * sizeof(ProductRecord);
+        header.levelsOffset = header.materialsOffset + header.materialsCount * sizeof(MaterialRecord);
+        header.rowsOffset = alignUp(header.levelsOffset + (linked ? header.levelsCount + 1 : 0) * sizeof(uint32_t));
+        header.inputsOffset = alignUp(header.rowsOffset + (linked ? header.productsCount + 1 : 0) * sizeof(uint32_t));
+        header.stringsOffset = alignUp(header.inputsOffset + (linked ? header.materialsCount : 0) * sizeof(ProductIndex));
+        header.imageSize = alignUp(header.stringsOffset + header.stringsSize);
+    }
+
+
+    bool nonNegative(double value) {
+        return std::isfinite(value) && value >= 0;
+    }
+
+
+    /**
+    *  @brief Mapped image sections, valid after openImage succeeded
+    */
+    struct ImageSections {
+        ImageHeader header;
+        const ProductRecord* products;
+        const MaterialRecord* materials;
+        const uint32_t* levelOffsets;      // levelsCount + 1 boundaries, linked image only
+        const uint32_t* rowOffsets;        // productsCount + 1 boundaries, linked image only
+        const ProductIndex* inputs;        // materialsCount indices, linked image only
+        const char* strings;
+
+        bool linked() const { return (header.flags & IMAGE_LINKED) != 0; }
+    };
+
+
+    /**
+    *  @brief Validates mapped image and locates its sections
+    *  @param image mapped image file
+    *  @param path image path for diagnostics
+    *  @param verifyChecksum also verify checksum of the whole image
+    *  @param sections output sections
+    *  @return true if the image is valid, false otherwise
+    */
+    bool openImage(const MappedFile& image, const std::string& path, bool verifyChecksum, ImageSections& sections) {
+
+        // Validate header and section bounds before touching records
+        ImageHeader& header = sections.header;
+        if (image.size() < sizeof(header)) return false;
+        std::memcpy(&header, image.data(), sizeof(header));
+        if (header.magic != IMAGE_MAGIC || header.endianness != IMAGE_ENDIANNESS || header.version != IMAGE_VERSION
+            || (header.flags & ~IMAGE_LINKED) != 0) {
+            std::cerr << "Invalid image header: " << path << '\n';
+            return false;
+        }
+        // Counts are bounded by the image size first, so section sizes and offsets cannot overflow
+        ImageHeader expected = header;
+        bool validCounts = header.productsCount > 0
+            && header.productsCount <= image.size() / sizeof(ProductRecord)
+            && header.materialsCount <= image.size() / sizeof(MaterialRecord)
+            && header.stringsSize <= image.size()
+            && header.levelsCount <= header.productsCount
+            && (sections.linked() ? header.levelsCount > 0 : header.levelsCount == 0);
+        if (validCounts) layoutSections(expected);
+        bool validLayout = validCounts
+            && header.imageSize == image.size()
+            && header.productsOffset == expected.productsOffset
+            && header.materialsOffset == expected.materialsOffset
+            && header.levelsOffset == expected.levelsOffset
+            && header.rowsOffset == expected.rowsOffset
+            && header.inputsOffset == expected.inputsOffset
+            && header.stringsOffset == expected.stringsOffset
+            && header.stringsOffset + header.stringsSize <= header.imageSize;
+        if (!validLayout) {
+            std::cerr << "Invalid image layout: " << path << '\n';
+            return false;
+        }
+        if (verifyChecksum && checksum(image.data() + sizeof(header), image.size() - sizeof(header)) != header.checksum) {
+            std::cerr << "Image checksum mismatch: " << path << '\n';
+            return false;
+        }
+
+        sections.products = reinterpret_cast<const ProductRecord*>(image.data() + header.productsOffset);
+        sections.materials = reinterpret_cast<const MaterialRecord*>(image.data() + header.materialsOffset);
+        sections.levelOffsets = reinterpret_cast<const uint32_t*>(image.data() + header.levelsOffset);
+        sections.rowOffsets = reinterpret_cast<const uint32_t*>(image.data() + header.rowsOffset);
+        sections.inputs = reinterpret_cast<const ProductIndex*>(image.data() + header.inputsOffset);
+        sections.strings = reinterpret_cast<const char*>(image.data() + header.stringsOffset);
+
+        // Every record is checked like a JSON product: ranges of the schema and of its name and materials
+        for (uint64_t i = 0; i < header.productsCount; i++) {
+            const ProductRecord& record = sections.products[i];
+            bool validRecord = record.type <= uint16_t(ProductType::Service)
+                && record.unit <= uint16_t(ProductUnit::Hour)
+                && record.nameOffset <= header.stringsSize
+                && record.nameLength <= header.stringsSize - record.nameOffset
+                && record.materialsOffset <= header.materialsCount
+                && record.materialsCount <= header.materialsCount - record.materialsOffset
+                && nonNegative(record.price) && nonNegative(record.cost)
+                && nonNegative(record.demand) && nonNegative(record.supply)
+                && nonNegative(record.importance) && record.importance <= 1
+                && nonNegative(record.floorMargin) && record.floorMargin <= 1
+                && nonNegative(record.turnover);
+            for (uint32_t m = 0; validRecord && m < record.materialsCount; m++) {
+                validRecord = nonNegative(sections.materials[record.materialsOffset + m].quantity);
+            }
+            if (!validRecord) {
+                std::cerr << "Invalid image record " << i << ": " << path << '\n';
+                return false;
+            }
+        }
+        if (!sections.linked()) return true;
+
+        // Linked sections: levels are ascending ranges of records, BoM rows follow the material
+        // records and every input is a record of a lower level with the ID of the material
+        const uint32_t* levelOffsets = sections.levelOffsets;
+        bool validLevels = levelOffsets[0] == 0 && levelOffsets[header.levelsCount] == header.productsCount;
+        for (uint32_t level = 0; validLevels && level < header.levelsCount; level++) {
+            validLevels = levelOffsets[level] < levelOffsets[level + 1];
+        }
+        bool validRows = validLevels && sections.rowOffsets[header.productsCount] == header.materialsCount;
+        uint32_t level = 0;
+        for (uint64_t i = 0; validRows && i < header.productsCount; i++) {
+            const ProductRecord& record = sections.products[i];
+            while (levelOffsets[level + 1] <= i) level++;
+            validRows = sections.rowOffsets[i] == record.materialsOffset
+                && sections.rowOffsets[i + 1] == record.materialsOffset + record.materialsCount;
+            for (uint64_t k = record.materialsOffset; validRows && k < record.materialsOffset + record.materialsCount; k++) {
+                ProductIndex input = sections.inputs[k];
+                validRows = input < levelOffsets[level] && sections.products[input].productID == sections.materials[k].input;
+            }
+        }
+        if (!validRows) {
+            std::cerr << "Invalid image bill of materials: " << path << '\n';
+            return false;
+        }
+        return true;
+    }
+
+
+    /**
+    *  @brief Copies records of validated image sections to products
+    *  @param sections validated image sections
+    *  @param products output vector to append products to
+    */
+    void appendProducts(const ImageSections& sections, ProductsList& products) {
+        products.reserve(products.size() + sections.header.productsCount);
+        for (uint64_t i = 0; i < sections.header.productsCount; i++) {
+            const ProductRecord& record = sections.products[i];
+            Product& product = products.emplace_back();
+            product.productID = ProductID(record.productID);
+            product.type = ProductType(record.type);
+            product.unit = ProductUnit(record.unit);
+            product.price = record.price;
+            product.cost = record.cost;
+            product.demand = record.demand;
+            product.supply = record.supply;
+            product.importance = record.importance;
+            product.floorMargin = record.floorMargin;
+            product.turnover = record.turnover;
+            product.name.assign(sections.strings + record.nameOffset, record.nameLength);
+            product.materials.resize(record.materialsCount);
+            for (uint32_t m = 0; m < record.materialsCount; m++) {
+                const MaterialRecord& material = sections.materials[record.materialsOffset + m];
+                product.materials[m] = { ProductID(material.input), material.quantity };
+            }
+        }
+    }
+
+}
+
+
+
+/**
+*  @brief Parses products from compiled catalog image (no linking)
+*  @param path relative path
+*  @param products output vector to append products to
+*  @param verifyChecksum also verify checksum of the whole image
+*  @return parsed products count or zero if failed
+*/
+size_t ProductsLoader::parseProductImage(const std::string& path, ProductsList& products, bool verifyChecksum) {
+
+    MappedFile image;
+    ImageSections sections;
+    if (!image.open(path) || !openImage(image, path, verifyChecksum, sections)) return 0;
+
+    size_t firstProduct = products.size();
+    appendProducts(sections, products);
+    return products.size() - firstProduct;
+}
+
+
+
+/**
+*  @brief Compiles product list to binary catalog image. A list in linked
+*         order (every input present and on a lower level, levels ascending)
+*         is written as a linked image with level offsets and BoM rows,
+*         any other list (a catalog shard) is written unlinked
+*  @param path relative path of the image file
+*  @param products products list to compile
+*  @return true if the image was written, false otherwise
+*/
+bool ProductsLoader::saveProductImage(const std::string& path, const ProductsList& products) {
+
+    if (products.empty()) return false;
+
+    // Measure sections
+    size_t materialsCount = 0;
+    size_t stringsSize = 0;
+    for (const Product& product : products) {
+        materialsCount += product.materials.size();
+        stringsSize += product.name.size();
+    }
+
+    // Find out if the list is linked: dense input indices and BoM levels of every product
+    ProductsIndex indexByID;
+    indexByID.reserve(products.size());
+    std::vector<ProductIndex> inputs;
+    inputs.reserve(materialsCount);
+    std::vector<uint32_t> levels(products.size(), 0);
+    std::vector<uint32_t> levelOffsets(1, 0);
+    bool linked = true;
+    for (size_t i = 0; linked && i < products.size(); i++) {
+        for (const Item& material : products[i].materials) {
+            auto input = indexByID.find(material.productID);
+            if (input == indexByID.end()) { linked = false; break; }
+            inputs.push_back(ProductIndex(input->second));
+            levels[i] = std::max(levels[i], levels[input->second] + 1);
+        }
+        linked = linked && indexByID.emplace(products[i].productID, i).second;
+        if (i > 0 && levels[i] != levels[i - 1]) {
+            linked = linked && levels[i] > levels[i - 1];
+            levelOffsets.push_back(uint32_t(i));
+        }
+    }
+    levelOffsets.push_back(uint32_t(products.size()));
+
+    ImageHeader header{};
+    header.magic = IMAGE_MAGIC;
+    header.version = IMAGE_VERSION;
+    header.endianness = IMAGE_ENDIANNESS;
+    header.flags = linked ? IMAGE_LINKED : 0;
+    header.levelsCount = linked ? uint32_t(levelOffsets.size() - 1) : 0;
+    header.productsCount = products.size();
+    header.materialsCount = materialsCount;
+    header.stringsSize = stringsSize;
+    layoutSections(header);
+
+    // Build the whole image in memory, then write it at once
+    std::vector<uint8_t> image(header.imageSize, 0);
+    auto* productRecords = reinterpret_cast<ProductRecord*>(image.data() + header.productsOffset);
+    auto* materialRecords = reinterpret_cast<MaterialRecord*>(image.data() + header.materialsOffset);
+    auto* rowOffsets = reinterpret_cast<uint32_t*>(image.data() + header.rowsOffset);
+    char* strings = reinterpret_cast<char*>(image.data() + header.stringsOffset);
+
+    size_t materialIndex = 0;
+    size_t stringOffset = 0;
+    for (size_t i = 0; i < products.size(); i++) {
+        const Product& product = products[i];
+        ProductRecord& record = productRecords[i];
+        record.productID = product.productID;
+        record.materialsOffset = materialIndex;
+        record.materialsCount = uint32_t(product.materials.size());
+        record.nameLength = uint32_t(product.name.size());
+        record.nameOffset = stringOffset;
+        record.type = uint16_t(product.type);
+        record.unit = uint16_t(product.unit);
+        record.price = product.price;
+        record.cost = product.cost;
+        record.demand = product.demand;
+        record.supply = product.supply;
+        record.importance = product.importance;
+        record.floorMargin = product.floorMargin;
+        record.turnover = product.turnover;
+        if (linked) rowOffsets[i] = uint32_t(materialIndex);
+        for (const Item& material : product.materials) {
+            materialRecords[materialIndex++] = { material.productID, material.quantity };
+        }
+        std::memcpy(strings + stringOffset, product.name.data(), product.name.size());
+        stringOffset += product.name.size();
+    }
+    if (linked) {
+        rowOffsets[products.size()] = uint32_t(materialIndex);
+        std::memcpy(image.data() + header.levelsOffset, levelOffsets.data(), levelOffsets.size() * sizeof(uint32_t));
+        std::memcpy(image.data() + header.inputsOffset, inputs.data(), inputs.size() * sizeof(ProductIndex));
+    }
+
+    header.checksum = checksum(image.data() + sizeof(header), image.size() - sizeof(header));
+    std::memcpy(image.data(), &header, sizeof(header));
+
+    std::ofstream imageFile(path, std::ios::binary | std::ios::trunc);
+    if (!imageFile.is_open()) return false;
+    imageFile.write(reinterpret_cast<const char*>(image.data()), std::streamsize(image.size()));
+    return bool(imageFile);
+}
+
+
+
+/**
+*  @brief Assigns catalog image to the pricer. Hot state, metadata, BoM rows
+*         and levels of a linked image are taken from the mapped sections as
+*         stored, without linking, ID lookups or intermediate Product objects.
+*         Unlinked image (a catalog shard) is loaded and linked as a list
+*  @param path relative path of the image file
+*  @param verifyChecksum also verify checksum of the whole image
+*  @return true if the image is valid, false otherwise
+*/
+bool ProductsPricer::assignProductImage(const std::string& path, bool verifyChecksum) {
+
+    MappedFile image;
+    ImageSections sections;
+    if (!image.open(path) || !openImage(image, path, verifyChecksum, sections)) return false;
+    if (!sections.linked()) {
+        ProductsList productsList;
+        appendProducts(sections, productsList);
+        if (!ProductsLoader::linkProductList(productsList)) return false;
+        assignProducts(productsList);
+        return true;
+    }
+
+    const size_t count = sections.header.productsCount;
+    const size_t materialsCount = sections.header.materialsCount;
+    state.resize(count);
+    info.clear();
+    info.reserve(count);
+    indexByID.clear();
+    indexByID.reserve(count);
+    for (size_t index = 0; index < count; index++) {
+        const ProductRecord& record = sections.products[index];
+        if (!indexByID.emplace(ProductID(record.productID), index).second) {
+            std::cerr << "Duplicate productID " << record.productID << " in image: " << path << '\n';
+            return false;
+        }
+        state.price[index] = record.price;
+        state.cost[index] = record.cost;
+        state.demand[index] = record.demand;
+        state.supply[index] = record.supply;
+        state.importance[index] = record.importance;
+        state.floorMargin[index] = record.floorMargin;
+        state.turnover[index] = record.turnover;
+        const MaterialRecord* material = sections.materials + record.materialsOffset;
+        BillOfMaterials billOfMaterials(record.materialsCount);
+        for (Item& item : billOfMaterials) { item = { ProductID(material->input), material->quantity }; material++; }
+        info.push_back({ ProductID(record.productID), ProductType(record.type), ProductUnit(record.unit),
+            std::string(sections.strings + record.nameOffset, record.nameLength), std::move(billOfMaterials) });
+    }
+
+    // BoM rows and level boundaries are stored in the pricer layout
+    materials.rowOffsets.assign(sections.rowOffsets, sections.rowOffsets + count + 1);
+    materials.inputs.assign(sections.inputs, sections.inputs + materialsCount);
+    materials.quantities.resize(materialsCount);
+    for (size_t k = 0; k < materialsCount; k++) materials.quantities[k] = sections.materials[k].quantity;
+    levelOffsets.assign(sections.levelOffsets, sections.levelOffsets + sections.header.levelsCount + 1);
+    levels.resize(count);
+    for (uint32_t level = 0; level < sections.header.levelsCount; level++) {
+        std::fill(levels.begin() + levelOffsets[level], levels.begin() + levelOffsets[level + 1], level);
+    }
+
+    initializeCatalog();
+    return true;
+}
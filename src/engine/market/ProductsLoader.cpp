@@ -10,11 +10,16 @@
  * fields, correct data types, and valid values.
  *
  * Main responsibilities:
- *  - Parse JSON file containing products.
+ *  - Parse JSON file containing products or a set of catalog shards.
  *  - Validate data schema and field consistency.
- *  - Detect duplicates and missing dependencies.
+ *  - Detect duplicates, missing dependencies and bill of materials cycles.
+ *  - Order products topologically, so inputs precede their consumers.
  *  - Convert JSON objects into Product structures.
  *
+ * The default loader streams the file through the nlohmann SAX interface
+ * and validates and builds Product records in a single pass without an
+ * intermediate DOM. The DOM based loader is kept as a reference path.
+ *
  * Returns the total number of successfully loaded products or zero
  * if validation or parsing fails.
  *
@@ -23,21 +28,502 @@
  * ============================================================================= */
 #include "engine/MarketEngine.h"
 
+#include <charconv>
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 
 
 using namespace Axionomy;
 
 
+namespace {
+
+    /**
+    *  @class ProductsSaxHandler
+    *  @brief Streaming products catalog parser built on nlohmann SAX events.
+    *
+    *  Tracks the nesting level of the document (catalog array, product object,
+    *  materials array, material object), checks each value against the schema
+    *  the moment it is read and appends complete products to the output list.
+    *  Values of unknown keys are skipped, including nested objects and arrays.
+    */
+    class ProductsSaxHandler : public nlohmann::json_sax<json> {
+    public:
+
+        ProductsSaxHandler(ProductsList& products) : products(products) {}
+
+        const std::string& getError() const { return error; }
+
+        bool null() override { return scalar(Value::Null); }
+        bool boolean(bool) override { return scalar(Value::Boolean); }
+        bool number_integer(number_integer_t val) override { return val < 0 ? number(double(val)) : integer(uint64_t(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return integer(val); }
+        bool number_float(number_float_t val, const string_t&) override { return number(val); }
+        bool binary(binary_t&) override { return scalar(Value::Other); }
+        bool string(string_t& val) override;
+        bool start_object(std::size_t elements) override;
+        bool key(string_t& val) override;
+        bool end_object() override;
+        bool start_array(std::size_t elements) override;
+        bool end_array() override;
+        bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex) override;
+
+    private:
+
+        // Document nesting levels
+        enum class Level : uint8_t { Root, Catalog, Product, Materials, Material };
+
+        // Value kinds that are not numbers or strings
+        enum class Value : uint8_t { Null, Boolean, Other };
+
+        // Known product and material fields
+        enum Field : uint32_t {
+            ProductIDField  = 1 << 0,  NameField       = 1 << 1,
+            TypeField       = 1 << 2,  UnitField       = 1 << 3,
+            PriceField      = 1 << 4,  CostField       = 1 << 5,
+            DemandField     = 1 << 6,  SupplyField     = 1 << 7,
+            ImportanceField = 1 << 8,  FloorMarginField = 1 << 9,
+            TurnoverField   = 1 << 10, MaterialsField  = 1 << 11,
+            InputField      = 1 << 12, QuantityField   = 1 << 13,
+            UnknownField    = 0
+        };
+
+        static constexpr uint32_t productFields = (1 << 12) - 1;
+        static constexpr uint32_t materialFields = InputField | QuantityField;
+
+        ProductsList& products;                // Output products list
+        Product product;                       // Product being parsed
+        Item material{};                       // Material being parsed
+        Level level = Level::Root;             // Current nesting level
+        uint32_t field = UnknownField;         // Field of the current key
+        uint32_t fieldsRead = 0;               // Fields read in the current object
+        size_t skipDepth = 0;                  // Nesting depth of skipped value
+        std::string error;                     // Validation error message
+
+        bool fail(const std::string& message);
+        bool unexpected();
+        bool scalar(Value value);
+        bool integer(uint64_t value);
+        bool number(double value);
+        bool finishProduct();
+    };
+
+
+    bool ProductsSaxHandler::fail(const std::string& message) {
+        error = "product #" + std::to_string(products.size()) + ": " + message;
+        return false;
+    }
+
+
+    bool ProductsSaxHandler::unexpected() {
+        switch (level) {
+        case Level::Root:      return fail("catalog must be an array of products");
+        case Level::Catalog:   return fail("product entry must be an object");
+        case Level::Materials: return fail("material entry must be an object");
+        default:               return fail("invalid value type");
+        }
+    }
+
+
+    bool ProductsSaxHandler::scalar(Value) {
+        if (skipDepth > 0) return true;
+        if ((level == Level::Product || level == Level::Material) && field == UnknownField) return true;
+        return unexpected();
+    }
+
+
+    // IDs keep the exact integer value, they are not converted through double
+    bool ProductsSaxHandler::integer(uint64_t value) {
+        if (skipDepth > 0) return true;
+        if (level != Level::Product && level != Level::Material) return unexpected();
+        switch (field) {
+        case ProductIDField:
+            product.productID = ProductID(value);
+            break;
+        case InputField:
+            material.productID = ProductID(value);
+            break;
+        default:
+            return number(double(value));
+        }
+        fieldsRead |= field;
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::number(double value) {
+        if (skipDepth > 0) return true;
+        if (level != Level::Product && level != Level::Material) return unexpected();
+        switch (field) {
+        case UnknownField: return true;
+        case ProductIDField:
+            return fail("productID must be a non-negative integer");
+        case PriceField:
+            if (value < 0) return fail("price must be non-negative");
+            product.price = value;
+            break;
+        case CostField:
+            if (value < 0) return fail("cost must be non-negative");
+            product.cost = value;
+            break;
+        case DemandField:
+            if (value < 0) return fail("demand must be non-negative");
+            product.demand = value;
+            break;
+        case SupplyField:
+            if (value < 0) return fail("supply must be non-negative");
+            product.supply = value;
+            break;
+        case ImportanceField:
+            if (value < 0 || value > 1) return fail("importance must be in [0:1]");
+            product.importance = value;
+            break;
+        case FloorMarginField:
+            if (value < 0 || value > 1) return fail("floorMargin must be in [0:1]");
+            product.floorMargin = value;
+            break;
+        case TurnoverField:
+            if (value < 0) return fail("turnover must be non-negative");
+            product.turnover = value;
+            break;
+        case InputField:
+            return fail("material input must be a non-negative integer");
+        case QuantityField:
+            if (value < 0) return fail("material quantity must be non-negative");
+            material.quantity = value;
+            break;
+        default:
+            return fail("invalid value type");
+        }
+        fieldsRead |= field;
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::string(string_t& val) {
+        if (skipDepth > 0) return true;
+        if (level != Level::Product && level != Level::Material) return unexpected();
+        switch (field) {
+        case UnknownField: return true;
+        case NameField:
+            if (val.empty()) return fail("name must be a non-empty string");
+            product.name = std::move(val);
+            break;
+        case TypeField:
+            if (val == "Good") product.type = ProductType::Good;
+            else if (val == "Service") product.type = ProductType::Service;
+            else return fail("unknown type '" + val + "'");
+            break;
+        case UnitField:
+            if (val == "Piece") product.unit = ProductUnit::Piece;
+            else if (val == "Kg") product.unit = ProductUnit::Kg;
+            else if (val == "Liter") product.unit = ProductUnit::Liter;
+            else if (val == "Hour") product.unit = ProductUnit::Hour;
+            else return fail("unknown unit '" + val + "'");
+            break;
+        default:
+            return fail("invalid value type");
+        }
+        fieldsRead |= field;
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::key(string_t& val) {
+        if (skipDepth > 0) return true;
+        field = UnknownField;
+        if (level == Level::Material) {
+            if (val == "input") field = InputField;
+            else if (val == "quantity") field = QuantityField;
+        } else {
+            switch (val.size()) {                     // dispatch on key length to avoid string compare chains
+            case 4:
+                if (val == "name") field = NameField;
+                else if (val == "type") field = TypeField;
+                else if (val == "unit") field = UnitField;
+                else if (val == "cost") field = CostField;
+                break;
+            case 5:  if (val == "price") field = PriceField; break;
+            case 6:
+                if (val == "demand") field = DemandField;
+                else if (val == "supply") field = SupplyField;
+                break;
+            case 8:  if (val == "turnover") field = TurnoverField; break;
+            case 9:
+                if (val == "productID") field = ProductIDField;
+                else if (val == "materials") field = MaterialsField;
+                break;
+            case 10: if (val == "importance") field = ImportanceField; break;
+            case 11: if (val == "floorMargin") field = FloorMarginField; break;
+            }
+        }
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::start_object(std::size_t) {
+        if (skipDepth > 0) { skipDepth++; return true; }
+        switch (level) {
+        case Level::Catalog:
+            product = Product{};
+            fieldsRead = 0;
+            level = Level::Product;
+            return true;
+        case Level::Materials:
+            material = Item{};
+            fieldsRead &= ~materialFields;
+            level = Level::Material;
+            return true;
+        case Level::Product:
+        case Level::Material:
+            if (field != UnknownField) return unexpected();
+            skipDepth = 1;
+            return true;
+        default:
+            return unexpected();
+        }
+    }
+
+
+    bool ProductsSaxHandler::end_object() {
+        if (skipDepth > 0) { skipDepth--; return true; }
+        if (level == Level::Material) {
+            if ((fieldsRead & materialFields) != materialFields) return fail("material requires input and quantity");
+            product.materials.push_back(material);
+            level = Level::Materials;
+            return true;
+        }
+        return finishProduct();
+    }
+
+
+    bool ProductsSaxHandler::start_array(std::size_t) {
+        if (skipDepth > 0) { skipDepth++; return true; }
+        switch (level) {
+        case Level::Root:
+            level = Level::Catalog;
+            return true;
+        case Level::Product:
+            if (field == UnknownField) { skipDepth = 1; return true; }
+            if (field != MaterialsField) return unexpected();
+            fieldsRead |= MaterialsField;
+            level = Level::Materials;
+            return true;
+        case Level::Material:
+            if (field == UnknownField) { skipDepth = 1; return true; }
+            return unexpected();
+        default:
+            return unexpected();
+        }
+    }
+
+
+    bool ProductsSaxHandler::end_array() {
+        if (skipDepth > 0) { skipDepth--; return true; }
+        if (level == Level::Materials) {
+            level = Level::Product;
+            return true;
+        }
+        level = Level::Root;
+        if (products.empty()) return fail("catalog must contain at least one product");
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::finishProduct() {
+        level = Level::Catalog;
+        if ((fieldsRead & productFields) != productFields) return fail("missing required fields");
+        products.push_back(std::move(product));
+        return true;
+    }
+
+
+    bool ProductsSaxHandler::parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) {
+        error = "parse error at byte " + std::to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+}
+
+
 
 /**
-*  @brief Loads product list from JSON file
-*  @param path relative path
-*  @param products output vector of products
+*  @brief Loads product list and links it, shards are parsed on a pool started for the load
+*  @param path relative path of JSON file, .axc image, directory or .manifest
+*  @param products output vector of products in topological order
 *  @return total products count or zero if failed
 */
 size_t ProductsLoader::loadProductList(const std::string& path, ProductsList& products) {
+    return loadProductList(path, products, nullptr);
+}
+
+
+
+/**
+*  @brief Loads product list and links it. The path may be a single catalog
+*         file, a directory of catalog shards or a shards manifest. Shards are
+*         parsed in parallel and merged in sorted path order, so the result
+*         does not depend on which shard finishes first.
+*  @param path relative path of JSON file, .axc image, directory or .manifest
+*  @param products output vector of products in topological order
+*  @param threadPool workers parsing the shards, nullptr starts a pool for the load
+*  @return total products count or zero if failed
+*/
+size_t ProductsLoader::loadProductList(const std::string& path, ProductsList& products, ThreadPool* threadPool) {
+    products.clear();
+    std::vector<std::string> shards;
+    if (!listCatalogShards(path, shards)) return 0;
+
+    size_t count = 0;
+    if (shards.size() == 1) {
+        count = parseCatalogShard(shards[0], products);
+    } else {
+        std::vector<ProductsList> shardProducts(shards.size());
+        std::unique_ptr<ThreadPool> ownPool;
+        if (threadPool == nullptr) {
+            ownPool = std::make_unique<ThreadPool>(std::min<size_t>(shards.size(), std::thread::hardware_concurrency()));
+            threadPool = ownPool.get();
+        }
+        threadPool->parallelFor(shards.size(), [&](size_t shard, size_t) {
+            parseCatalogShard(shards[shard], shardProducts[shard]);
+        });
+        size_t total = 0;
+        for (size_t shard = 0; shard < shards.size(); shard++) {
+            if (shardProducts[shard].empty()) {
+                std::cerr << "Failed to load catalog shard: " << shards[shard] << '\n';
+                return 0;
+            }
+            total += shardProducts[shard].size();
+        }
+        products.reserve(total);
+        for (ProductsList& shard : shardProducts) {                 // merge in deterministic shard order
+            std::move(shard.begin(), shard.end(), std::back_inserter(products));
+        }
+        count = total;
+    }
+
+    if (count == 0 || !linkProductList(products)) {                 // cross-shard duplicates and dependencies
+        products.clear();
+        return 0;
+    }
+    return count;
+}
+
+
+
+/**
+*  @brief Resolves catalog path to the sorted list of shard files
+*  @param path catalog file, directory of shards or .manifest file
+*  @param shards output list of shard file paths
+*  @return true if at least one shard was found, false otherwise
+*/
+bool ProductsLoader::listCatalogShards(const std::string& path, std::vector<std::string>& shards) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::path catalogPath(path);
+
+    if (fs::is_directory(catalogPath, error)) {
+        // every .json and .axc file of the directory is a shard, a compiled .axc image replaces the
+        // .json shard of the same stem, so a catalog next to its compiled image is loaded once
+        std::map<fs::path, fs::path> shardByStem;
+        for (const auto& entry : fs::directory_iterator(catalogPath, error)) {
+            auto extension = entry.path().extension();
+            if (!entry.is_regular_file() || (extension != ".json" && extension != ".axc")) continue;
+            fs::path& shard = shardByStem[entry.path().parent_path() / entry.path().stem()];
+            if (shard.empty() || extension == ".axc") shard = entry.path();
+        }
+        for (const auto& [stem, shard] : shardByStem) shards.push_back(shard.string());
+        std::sort(shards.begin(), shards.end());
+    } else if (catalogPath.extension() == ".manifest") {
+        // manifest lists shards relative to its own directory: { "shards": [ "a.json", ... ] }
+        std::ifstream manifestFile(path);
+        if (!manifestFile.is_open()) return false;
+        try {
+            json manifest = json::parse(manifestFile);
+            for (const auto& shard : manifest.at("shards")) {
+                shards.push_back((catalogPath.parent_path() / shard.get<std::string>()).string());
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Invalid manifest " << path << ": " << e.what() << '\n';
+            return false;
+        }
+    } else {
+        shards.push_back(path);
+    }
+
+    if (shards.empty()) std::cerr << "No catalog shards found: " << path << '\n';
+    return !shards.empty();
+}
+
+
+
+/**
+*  @brief Parses single catalog shard, JSON or compiled image (no linking)
+*  @param path relative path of shard file
+*  @param products output vector to append products to
+*  @return parsed products count or zero if failed
+*/
+size_t ProductsLoader::parseCatalogShard(const std::string& path, ProductsList& products) {
+    bool isImage = std::filesystem::path(path).extension() == ".axc";
+    return isImage ? parseProductImage(path, products) : parseProductList(path, products);
+}
+
+
+
+/**
+*  @brief Loads product list from compiled catalog image and links it
+*  @param path relative path
+*  @param products output vector of products in topological order
+*  @param verifyChecksum also verify checksum of the whole image
+*  @return total products count or zero if failed
+*/
+size_t ProductsLoader::loadProductImage(const std::string& path, ProductsList& products, bool verifyChecksum) {
+    products.clear();
+    size_t count = parseProductImage(path, products, verifyChecksum);
+    if (count == 0 || !linkProductList(products)) {
+        products.clear();
+        return 0;
+    }
+    return count;
+}
+
+
+
+/**
+*  @brief Parses products from JSON file in a single streaming pass (no linking)
+*  @param path relative path
+*  @param products output vector to append products to
+*  @return parsed products count or zero if failed
+*/
+size_t ProductsLoader::parseProductList(const std::string& path, ProductsList& products) {
+    std::ifstream productListFile(path, std::ios::binary | std::ios::ate);  // Open the file at its end
+    std::streamoff size = productListFile.tellg();
+    if (!productListFile.is_open() || size < 0) return 0;           // if file is can not be opened, return zero products
+    std::string text(size_t(size), '\0');                           // read raw text at once into one buffer of the file
+    productListFile.seekg(0);                                       // size, the parser is faster on contiguous memory
+    if (!productListFile.read(text.data(), size)) return 0;
+    size_t firstProduct = products.size();
+    ProductsSaxHandler handler(products);
+    if (!json::sax_parse(text.begin(), text.end(), &handler)) {     // validate and build products in one pass
+        std::cerr << "Invalid schema: " << path << " (" << handler.getError() << ")\n";
+        products.resize(firstProduct);                              // drop partially loaded products
+        return 0;
+    }
+    return products.size() - firstProduct;
+}
+
+
+
+/**
+*  @brief Loads product list from JSON file through the DOM (reference path)
+*  @param path relative path
+*  @param products output vector of products in topological order
+*  @return total products count or zero if failed
+*/
+size_t ProductsLoader::loadProductListDOM(const std::string& path, ProductsList& products) {
+    products.clear();
     std::ifstream productListFile(path);                            // Open the file
     if (!productListFile.is_open()) return 0;                       // if file is can not be opened, return zero products    
     size_t count = 0;                                               // set initial products count to zero    
@@ -57,6 +543,10 @@ size_t ProductsLoader::loadProductList(const std::string& path, ProductsList& pr
                 return 0;
             }
         }
+        if (!linkProductList(products)) {                           // check dependencies and order products
+            products.clear();
+            return 0;
+        }
     }
     catch (const json::parse_error& e) {
         std::cerr << "Parse error at byte " << e.byte << ": " << e.what() << '\n';
@@ -71,6 +561,54 @@ size_t ProductsLoader::loadProductList(const std::string& path, ProductsList& pr
 
 
 
+/**
+*  @brief Saves product list to JSON file in the catalog schema
+*  @param path relative path
+*  @param products products list to save
+*  @return true if the file was written, false otherwise
+*/
+bool ProductsLoader::saveProductList(const std::string& path, const ProductsList& products) {
+    static const char* types[] = { "Good", "Service" };
+    static const char* units[] = { "Piece", "Kg", "Liter", "Hour" };
+
+    // Shortest decimal form that parses back to exactly the same double
+    char number[32];
+    auto format = [&number](double value) {
+        auto result = std::to_chars(number, number + sizeof(number), value);
+        return std::string_view(number, size_t(result.ptr - number));
+    };
+
+    // Catalog is streamed as text, large catalogs do not fit a JSON DOM comfortably
+    std::ofstream productListFile(path, std::ios::trunc);
+    if (!productListFile.is_open()) return false;
+    productListFile << "[\n";
+    for (size_t i = 0; i < products.size(); i++) {
+        const Product& product = products[i];
+        productListFile << "  {\n"
+            << "    \"productID\": " << product.productID << ",\n"
+            << "    \"name\": " << json(product.name).dump() << ",\n"
+            << "    \"type\": \"" << types[size_t(product.type)] << "\",\n"
+            << "    \"unit\": \"" << units[size_t(product.unit)] << "\",\n"
+            << "    \"price\": " << format(product.price) << ",\n"
+            << "    \"cost\": " << format(product.cost) << ",\n"
+            << "    \"demand\": " << format(product.demand) << ",\n"
+            << "    \"supply\": " << format(product.supply) << ",\n"
+            << "    \"importance\": " << format(product.importance) << ",\n"
+            << "    \"floorMargin\": " << format(product.floorMargin) << ",\n"
+            << "    \"turnover\": " << format(product.turnover) << ",\n"
+            << "    \"materials\": [";
+        for (size_t m = 0; m < product.materials.size(); m++) {
+            productListFile << (m ? ", " : "") << "{ \"input\": " << product.materials[m].productID
+                << ", \"quantity\": " << format(product.materials[m].quantity) << " }";
+        }
+        productListFile << "]\n  }" << (i + 1 < products.size() ? ",\n" : "\n");
+    }
+    productListFile << "]\n";
+    return bool(productListFile);
+}
+
+
+
 /**
 *  @brief Validates the JSON schema of products file
 *  @param data JSON object containing product list
@@ -150,13 +688,9 @@ bool ProductsLoader::validateSchema(json& data) {
 */
 bool ProductsLoader::loadProduct(json& productData, ProductsList& products) {
 
-    // Check for duplicates
-    uint32_t id = productData.value("productID", 0);;
-    if (productListContains(id, products)) return false;
-
     // Fetch fields from JSON to Product object
     Product product;
-    product.productID = id;
+    product.productID = productData.at("productID").get<ProductID>();
     product.type = productData.value("type", "") == "Good" ? ProductType::Good : ProductType::Service;
     std::string unitStr = productData.value("unit", "");
     product.unit = ProductUnit::Piece;
@@ -179,8 +713,6 @@ bool ProductsLoader::loadProduct(json& productData, ProductsList& products) {
     for (const auto& material : materialsList) {
         ProductID input = material.at("input").get<ProductID>();
         double quantity = material.at("quantity").get<double>();
-        // check if input exist in the product list
-        if (!productListContains(input, products)) return false;        
         product.materials.push_back({ input, quantity });
     }
 
@@ -192,14 +724,131 @@ bool ProductsLoader::loadProduct(json& productData, ProductsList& products) {
 
 
 /**
-*  @brief Checks if product list already contains product ID
-*  @param productID ID of product
-*  @param products output vector of products
-*  @return true if the schema is valid, false otherwise
+*  @brief Links product list: checks duplicates, missing inputs and bill of
+*         materials cycles in O(N + E) and stores products in topological
+*         order, so every product follows all of its inputs. Products are
+*         grouped by BoM level (raw inputs at level zero, every product one
+*         level above its deepest input), each level is a contiguous range
+*  @param products vector of products in any order, reordered in place
+*  @return true if the list is consistent, false otherwise
 */
-bool ProductsLoader::productListContains(ProductID productID, const ProductsList& products) {
-    for (const Product& product : products) {
-        if (product.productID == productID) return true;
+bool ProductsLoader::linkProductList(ProductsList& products) {
+
+    const size_t count = products.size();
+    constexpr size_t UNVISITED = NOT_FOUND;
+
+    // Index products by ID and detect duplicates
+    ProductsIndex indexByID;
+    indexByID.reserve(count);
+    bool consistent = true;
+    for (size_t index = 0; index < count; index++) {
+        if (!indexByID.emplace(products[index].productID, index).second) {
+            std::cerr << "Duplicate productID " << products[index].productID << '\n';
+            consistent = false;
+        }
     }
-    return false;
+
+    // Build adjacency (product -> inputs) in CSR form and detect missing inputs
+    std::vector<size_t> edgeOffsets(count + 1, 0);
+    std::vector<size_t> edges;
+    for (size_t index = 0; index < count; index++) {
+        for (const Item& material : products[index].materials) {
+            auto it = indexByID.find(material.productID);
+            if (it == indexByID.end()) {
+                std::cerr << "Product " << products[index].productID
+                          << " requires missing input " << material.productID << '\n';
+                consistent = false;
+                continue;
+            }
+            edges.push_back(it->second);
+        }
+        edgeOffsets[index + 1] = edges.size();
+    }
+    if (!consistent) return false;
+
+    // Iterative Tarjan's strongly connected components. Components are emitted
+    // after all of their inputs, which is exactly the required topological order.
+    std::vector<size_t> visitOrder(count, UNVISITED);
+    std::vector<size_t> lowLink(count, 0);
+    std::vector<bool> onStack(count, false);
+    std::vector<size_t> componentStack;
+    std::vector<std::pair<size_t, size_t>> callStack;              // (node, next edge)
+    std::vector<size_t> topologicalOrder;
+    topologicalOrder.reserve(count);
+    size_t visitCounter = 0;
+
+    for (size_t root = 0; root < count; root++) {
+        if (visitOrder[root] != UNVISITED) continue;
+        callStack.emplace_back(root, edgeOffsets[root]);
+        visitOrder[root] = lowLink[root] = visitCounter++;
+        componentStack.push_back(root);
+        onStack[root] = true;
+
+        while (!callStack.empty()) {
+            auto& [node, edge] = callStack.back();
+            if (edge < edgeOffsets[node + 1]) {
+                size_t input = edges[edge++];
+                if (visitOrder[input] == UNVISITED) {                // descend into input
+                    visitOrder[input] = lowLink[input] = visitCounter++;
+                    componentStack.push_back(input);
+                    onStack[input] = true;
+                    callStack.emplace_back(input, edgeOffsets[input]);
+                } else if (onStack[input]) {
+                    lowLink[node] = std::min(lowLink[node], visitOrder[input]);
+                }
+                continue;
+            }
+
+            // All inputs visited: emit component if node is its root
+            size_t finished = node;
+            callStack.pop_back();
+            if (!callStack.empty()) {
+                size_t parent = callStack.back().first;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[finished]);
+            }
+            if (lowLink[finished] != visitOrder[finished]) continue;
+
+            size_t componentStart = componentStack.size();
+            do componentStart--; while (componentStack[componentStart] != finished);
+            bool selfLoop = false;
+            for (size_t e = edgeOffsets[finished]; e < edgeOffsets[finished + 1]; e++) {
+                selfLoop |= edges[e] == finished;
+            }
+            if (componentStack.size() - componentStart > 1 || selfLoop) {
+                std::cerr << "Bill of materials cycle between products:";
+                for (size_t i = componentStart; i < componentStack.size(); i++) {
+                    std::cerr << ' ' << products[componentStack[i]].productID;
+                }
+                std::cerr << '\n';
+                consistent = false;
+            }
+            for (size_t i = componentStart; i < componentStack.size(); i++) {
+                onStack[componentStack[i]] = false;
+                topologicalOrder.push_back(componentStack[i]);
+            }
+            componentStack.resize(componentStart);
+        }
+    }
+    if (!consistent) return false;
+
+    // Assign BoM levels in topological order, inputs are always leveled first
+    std::vector<size_t> level(count, 0);
+    std::vector<size_t> levelOffsets(1, 0);
+    for (size_t index : topologicalOrder) {
+        for (size_t e = edgeOffsets[index]; e < edgeOffsets[index + 1]; e++) {
+            level[index] = std::max(level[index], level[edges[e]] + 1);
+        }
+        if (level[index] + 1 >= levelOffsets.size()) levelOffsets.resize(level[index] + 2, 0);
+        levelOffsets[level[index] + 1]++;
+    }
+    for (size_t l = 1; l < levelOffsets.size(); l++) levelOffsets[l] += levelOffsets[l - 1];
+
+    // Store products level by level keeping topological order within a level (stable counting sort)
+    std::vector<size_t> position(count);
+    for (size_t index : topologicalOrder) position[levelOffsets[level[index]]++] = index;
+    ProductsList ordered;
+    ordered.reserve(count);
+    for (size_t index : position) ordered.push_back(std::move(products[index]));
+    products = std::move(ordered);
+    return true;
 }
@@ -10,14 +10,40 @@
  * market prices dynamically using an asymmetric sigmoid function that models
  * the relationship between demand, supply, and price elasticity.
  *
+ * Per-tick numeric state is kept in a structure of arrays (ProductsState)
+ * separately from names and bills of materials (ProductInfo), so pricing
+ * passes stream only the data they use. Bills of materials are compiled to a
+ * compressed sparse row matrix over dense product indices (MaterialsMatrix). getProductsList() assembles
+ * read-only product views on demand.
+ *
  * Main responsibilities:
  *  - Load and index all products from a JSON catalog.
  *  - Compute product costs from Bill of Materials.
+ *  - Evaluate price multipliers of all products in one SIMD batch
+ *    (see PricingKernels), then costs and prices in topological order.
+ *  - Evaluate BoM levels in parallel on an optional thread pool: products
+ *    of one level depend only on lower levels, levels are separated by the
+ *    barrier of ThreadPool::parallelFor, results match the sequential pass.
+ *  - Incremental mode: reprice only dirty products. A product gets dirty when
+ *    its demand or supply changes or an input price drifts by more than the
+ *    relative epsilon from the price last propagated to consumers, and stays
+ *    dirty until its price is within epsilon of the target. Dirtiness is
+ *    propagated through the transposed BoM level by level, so a tick costs
+ *    O(changed products and their consumers) instead of O(N).
+ *  - Multipliers precision is selectable (PricingPrecision): double, float
+ *    or float with fast polynomial math, prices and costs stay double.
+ *  - Fast-forward N ticks under frozen demand and supply: products with
+ *    constant cost jump to target + (1 - 1/turnover)^N * (price - target),
+ *    only products fed by moving inputs are stepped tick by tick. Inputs
+ *    within the fast-forward tolerance of their targets count as constant,
+ *    independently of the incremental mode epsilon.
  *  - Evaluate product prices based on demandsupply imbalance.
  *  - Update market data such as demand and supply for each product.
+ *  - Hot-reload the catalog keeping market state of unchanged products.
  *
  * Notes:
- *  - Lookup operations are O(1) using an internal hash map.
+ *  - Products are addressed by dense indices internally, external IDs are
+ *    translated through an internal hash map at the API boundary only.
  *  - Cost and price evaluations are O(N).
  *  - Not thread-safe for concurrent modifications.
  *  - Designed for use in economic and agent-based simulations.
@@ -29,31 +55,206 @@
 
 #include "engine/MarketEngine.h"
 #include <algorithm>
+#include <filesystem>
 
 
 using namespace Axionomy;
 
 
-ProductsPricer::ProductsPricer(const std::string& path) {    
+ProductsPricer::ProductsPricer(const std::string& path, bool verifyImage) {    
+
+    // Catalog image is assigned by the image loader, linked image without relinking
+    if (std::filesystem::path(path).extension() == ".axc") {
+        ProductsList productsList;
+        if (!assignProductImage(path, verifyImage)) assignProducts(productsList);
+        return;
+    }
 
     // Load products
-    size_t productsCount = ProductsLoader::loadProductList(path, products);    
+    ProductsList productsList;
+    size_t productsCount = ProductsLoader::loadProductList(path, productsList);    
     if (productsCount == 0) {
         // TODO: do something about absene of file
     }
 
-    // Create index
-    indexByID.reserve(productsCount);
-    for (size_t index = 0; index < products.size(); index++) {
-        ProductID id = products[index].productID;
-        indexByID.emplace(id, index);
+    // Split products to hot state and cold metadata, create index
+    assignProducts(productsList);
+
+}
+
+
+void ProductsState::resize(size_t count) {
+    price.resize(count);
+    cost.resize(count);
+    demand.resize(count);
+    supply.resize(count);
+    importance.resize(count);
+    floorMargin.resize(count);
+    turnover.resize(count);
+    multiplier.resize(count);
+}
+
+
+ProductView ProductsView::operator[](size_t index) const {
+    const ProductInfo& product = info[index];
+    return ProductView{
+        product.productID, product.type, product.unit,
+        state.price[index], state.cost[index], state.demand[index], state.supply[index],
+        state.importance[index], state.floorMargin[index], state.turnover[index],
+        product.name, product.materials
+    };
+}
+
+
+ProductView::operator Product() const {
+    return Product{ productID, type, unit, price, cost, demand, supply,
+        importance, floorMargin, turnover, name, materials };
+}
+
+
+void ProductsPricer::assignProducts(ProductsList& productsList) {
+    size_t count = productsList.size();
+    state.resize(count);
+    info.clear();
+    info.reserve(count);
+    materials.clear();
+    indexByID.clear();
+    indexByID.reserve(count);
+    for (size_t index = 0; index < count; index++) {
+        Product& product = productsList[index];
+        state.price[index] = product.price;
+        state.cost[index] = product.cost;
+        state.demand[index] = product.demand;
+        state.supply[index] = product.supply;
+        state.importance[index] = product.importance;
+        state.floorMargin[index] = product.floorMargin;
+        state.turnover[index] = product.turnover;
+        info.push_back({ product.productID, product.type, product.unit,
+            std::move(product.name), std::move(product.materials) });
+        indexByID.emplace(product.productID, index);
+    }
+
+    // Remap bills of materials to dense indices once, products are linked
+    // and topologically ordered, so every input is already indexed
+    for (size_t index = 0; index < count; index++) {
+        materials.appendRow(info[index].materials, indexByID);
     }
 
+    // Linker groups products by BoM level, find level boundaries
+    levels.assign(count, 0);
+    levelOffsets.assign(1, 0);
+    bool leveled = true;
+    for (size_t index = 0; index < count; index++) {
+        for (uint32_t k = materials.rowOffsets[index]; k < materials.rowOffsets[index + 1]; k++) {
+            levels[index] = std::max(levels[index], levels[materials.inputs[k]] + 1);
+        }
+        if (index > 0 && levels[index] != levels[index - 1]) {
+            leveled &= levels[index] > levels[index - 1];
+            levelOffsets.push_back(uint32_t(index));
+        }
+    }
+    levelOffsets.push_back(uint32_t(count));
+    // Not grouped by level, evaluate sequentially
+    if (!leveled) levelOffsets.clear();
+
+    initializeCatalog();
 }
 
 
-const ProductsList& ProductsPricer::getProductsList() const {
-    return products;
+void ProductsPricer::initializeCatalog() {
+    materials.transpose(consumers);
+
+    // New catalog starts with every product dirty
+    size_t count = info.size();
+    uint32_t levelsCount = count == 0 ? 0 : *std::max_element(levels.begin(), levels.end()) + 1;
+    dirty.assign(count, 0);
+    dirtyLevels.assign(levelsCount, {});
+    if (incremental) markAllDirty();
+}
+
+
+bool ProductsPricer::reloadProducts(const std::string& path, ProductsDiff& diff) {
+
+    // Load and link new catalog, keep the current one if it is invalid. Reload is O(catalog):
+    // dense indices and levels may shift anywhere, so the whole catalog is relinked and
+    // every per-product array is remapped, only costs of affected products are re-evaluated
+    ProductsList reloaded;
+    if (ProductsLoader::loadProductList(path, reloaded) == 0) return false;
+
+    diff.added.clear();
+    diff.removed.clear();
+    diff.changed.clear();
+    diff.remap.assign(info.size(), NOT_FOUND);
+
+    // Match products by ID: keep market state of existing products,
+    // take static parameters (importance, floorMargin, turnover, BoM...) from the new catalog
+    std::vector<bool> affected(reloaded.size(), false);
+    std::vector<bool> retained(info.size(), false);
+    for (size_t index = 0; index < reloaded.size(); index++) {
+        Product& product = reloaded[index];
+        size_t oldIndex = getIndexByProductID(product.productID);
+        if (oldIndex == NOT_FOUND) {
+            diff.added.push_back(product.productID);
+            affected[index] = true;
+            continue;
+        }
+        const ProductInfo& current = info[oldIndex];
+        retained[oldIndex] = true;
+        diff.remap[oldIndex] = index;
+        bool sameMaterials = product.materials.size() == current.materials.size()
+            && std::equal(product.materials.begin(), product.materials.end(), current.materials.begin(),
+                [](const Item& a, const Item& b) { return a.productID == b.productID && a.quantity == b.quantity; });
+        bool changed = !sameMaterials
+            || product.type != current.type || product.unit != current.unit
+            || product.importance != state.importance[oldIndex] || product.floorMargin != state.floorMargin[oldIndex]
+            || product.turnover != state.turnover[oldIndex] || product.name != current.name;
+        if (changed) {
+            diff.changed.push_back(product.productID);
+            affected[index] = true;
+        }
+        product.price = state.price[oldIndex];
+        product.demand = state.demand[oldIndex];
+        product.supply = state.supply[oldIndex];
+        if (!product.materials.empty() || !changed) product.cost = state.cost[oldIndex];
+    }
+    for (size_t oldIndex = 0; oldIndex < info.size(); oldIndex++) {
+        if (!retained[oldIndex]) diff.removed.push_back(info[oldIndex].productID);
+    }
+
+    assignProducts(reloaded);
+
+    // Products are in topological order, so a single forward pass propagates
+    // changes from added and changed products to all of their BoM dependents
+    for (size_t index = 0; index < info.size(); index++) {
+        if (!affected[index]) {
+            for (uint32_t k = materials.rowOffsets[index]; k < materials.rowOffsets[index + 1]; k++) {
+                if (affected[materials.inputs[k]]) { affected[index] = true; break; }
+            }
+        }
+        if (affected[index]) evaluateProductCost(index);
+    }
+
+    return true;
+}
+
+
+ProductsView ProductsPricer::getProductsList() const {
+    return ProductsView(info, state);
+}
+
+
+const ProductsState& ProductsPricer::getProductsState() const {
+    return state;
+}
+
+
+size_t ProductsPricer::getProductsCount() const {
+    return info.size();
+}
+
+
+ProductID ProductsPricer::getProductID(size_t index) const {
+    return info[index].productID;
 }
 
 
@@ -66,78 +267,324 @@ size_t ProductsPricer::getIndexByProductID(ProductID productID) const {
 
 Money ProductsPricer::getProductPrice(ProductID productID) const {
     size_t index = getIndexByProductID(productID);
-    if (index == NOT_FOUND) return 0ULL;
-    return products[index].price;
+    if (index == NOT_FOUND) return Money(0);
+    // Pricer works in floating point, money is converted at the boundary
+    return Money(state.price[index]);
+}
+
+
+Price ProductsPricer::getPrice(size_t index) const {
+    return state.price[index];
 }
 
 
 bool ProductsPricer::computeEquilibriumPrice(ProductID productID, Quantity demand, Quantity supply) {
     size_t index = getIndexByProductID(productID);
     if (index == NOT_FOUND) return false;
-    Product& productData = products[index];
-    productData.demand = demand;
-    productData.supply = supply;    
-    evaluateProductPrice(productData);
+    setMarketData(index, demand, supply);
+    evaluateProductPrice(index);
     return true;
 }
 
 
-void ProductsPricer::evaluateProductPrice(Product& product) {
+void ProductsPricer::setMarketData(size_t index, Quantity demand, Quantity supply) {
+    bool changed = state.demand[index] != demand || state.supply[index] != supply;
+    state.demand[index] = demand;
+    state.supply[index] = supply;
+    // Multiplier depends on own market data only, incremental mode keeps it up to date here
+    if (incremental && changed) {
+        state.multiplier[index] = PricingKernels::evaluateMultiplier(demand, supply, state.importance[index], pricingPrecision);
+        markDirty(index);
+    }
+}
+
+
+void ProductsPricer::evaluatePrices() {
+    if (incremental) {
+        evaluateDirtyProducts();
+        return;
+    }
+    repricedCount = info.size();
+    const size_t count = info.size();
+    if (threadPool == nullptr || threadPool->getThreadsCount() == 1 || levelOffsets.empty() || count <= PARALLEL_CHUNK) {
+        evaluateRange(0, count, true);
+        return;
+    }
 
-    // fetch values and convert to double
-    double demand = double(product.demand);
-    double supply = double(product.supply);
-    
-    // disbalance sensitivity (maximum 1% deficit adds 10% to price)
-    constexpr double maxElasticity = 12.305019857643899;
-    double k = product.importance * maxElasticity;
-
-    // sigmoid asymmetry parameters
-    constexpr double minY = 0.4; // minimal price multiplier
-    constexpr double maxY = 4.0; // maximum price multiplier
-    constexpr double diff = maxY - minY;
-    static const double v = std::log2((maxY - minY) / (1 - minY));
-    
-    // Division-by-zero protection (bias)
-    constexpr double bias = 0.001;
+    // Multipliers do not depend on costs, evaluate them for all products at once
+    size_t chunks = (count + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK;
+    threadPool->parallelFor(chunks, [this, count](size_t chunk, size_t) {
+        size_t begin = chunk * PARALLEL_CHUNK;
+        PricingKernels::evaluateMultipliers(pricingKernel, state.demand.data() + begin, state.supply.data() + begin,
+            state.importance.data() + begin, state.multiplier.data() + begin, std::min(PARALLEL_CHUNK, count - begin), pricingPrecision);
+    });
+
+    // Level by level: products of a level read prices of lower levels only,
+    // parallelFor returns when the whole level is priced
+    for (size_t level = 0; level + 1 < levelOffsets.size(); level++) {
+        const size_t begin = levelOffsets[level];
+        const size_t end = levelOffsets[level + 1];
+        if (end - begin <= PARALLEL_CHUNK) {
+            evaluateRange(begin, end, false);
+            continue;
+        }
+        threadPool->parallelFor((end - begin + PARALLEL_CHUNK - 1) / PARALLEL_CHUNK, [this, begin, end](size_t chunk, size_t) {
+            size_t first = begin + chunk * PARALLEL_CHUNK;
+            evaluateRange(first, std::min(first + PARALLEL_CHUNK, end), false);
+        });
+    }
+}
+
+
+void ProductsPricer::evaluateRange(size_t begin, size_t end, bool multipliers) {
+    // demand/supply multipliers do not depend on costs, evaluate them in one batch
+    if (multipliers) {
+        PricingKernels::evaluateMultipliers(pricingKernel, state.demand.data() + begin, state.supply.data() + begin,
+            state.importance.data() + begin, state.multiplier.data() + begin, end - begin, pricingPrecision);
+    }
+    // sparse BoM matrix times prices vector in topological order: inputs are always
+    // priced before their consumers, so costs are consistent within the tick
+    for (size_t index = begin; index < end; index++) {
+        adjustProductPrice(index);
+    }
+}
+
+
+PricingKernel ProductsPricer::getPricingKernel() const {
+    return pricingKernel;
+}
+
+
+bool ProductsPricer::setPricingKernel(PricingKernel kernel) {
+    if (!PricingKernels::isSupported(kernel)) return false;
+    pricingKernel = kernel;
+    return true;
+}
+
+
+void ProductsPricer::evaluateDirtyProducts() {
+    repricedCount = 0;
+    // Consumers are always on higher levels, so a level is complete when reached
+    for (std::vector<ProductIndex>& level : dirtyLevels) {
+        repricing.swap(level);
+        level.clear();
+        // Dense index order keeps memory access close to sequential
+        std::sort(repricing.begin(), repricing.end());
+        for (ProductIndex index : repricing) {
+            dirty[index] = 0;
+            Price previousPrice = state.price[index];
+            adjustProductPrice(index);
+            repricedCount++;
+            Price price = state.price[index];
+
+            // Remaining distance to target is (turnover - 1) steps, reprice next tick until it is within epsilon
+            if (std::abs(price - previousPrice) * (state.turnover[index] - 1) > epsilon * std::abs(price)) markDirty(index);
+
+            // Consumers are repriced when the price drifts from the one they have seen by more than epsilon
+            if (std::abs(price - propagatedPrice[index]) <= epsilon * std::abs(propagatedPrice[index])) continue;
+            propagatedPrice[index] = price;
+            for (uint32_t k = consumers.rowOffsets[index]; k < consumers.rowOffsets[index + 1]; k++) {
+                markDirty(consumers.inputs[k]);
+            }
+        }
+    }
+}
+
+
+/**
+*  @brief Advances prices by ticks under frozen demand and supply. Price of a product with
+*         constant cost follows the closed form target + (1 - 1/turnover)^ticks * (price - target),
+*         cost is constant when all inputs are stationary. Products fed by moving inputs are
+*         stepped tick by tick.
+*  @param ticks number of ticks to skip
+*  @param tolerance relative distance between price and target, within which a product is
+*         stationary; the closed form of its consumers is off by up to this share of the input
+*         prices
+*/
+void ProductsPricer::fastForward(size_t ticks, double tolerance) {
+    const size_t count = info.size();
+    if (ticks == 0 || count == 0) return;
+
+    // Demand and supply are frozen, so are multipliers
+    PricingKernels::evaluateMultipliers(pricingKernel, state.demand.data(), state.supply.data(),
+        state.importance.data(), state.multiplier.data(), count, pricingPrecision);
+
+    // Cost is constant if all inputs are stationary (already at target), in topological order
+    std::vector<uint8_t> stationary(count, 0);
+    std::vector<uint8_t> stepping(count, 0);
+    for (size_t index = 0; index < count; index++) {
+        bool constantCost = true;
+        for (uint32_t k = materials.rowOffsets[index]; k < materials.rowOffsets[index + 1]; k++) {
+            constantCost &= stationary[materials.inputs[k]] != 0;
+        }
+        if (!constantCost) {
+            stepping[index] = 1;
+            continue;
+        }
+        evaluateProductCost(index);
+        Price target = state.cost[index] * (1.0 + state.floorMargin[index]) * state.multiplier[index];
+        stationary[index] = std::abs(target - state.price[index]) <= tolerance * std::abs(state.price[index]);
+    }
 
-    // measure disbalance and ratio
-    double balanceAmount = demand - supply;
-    double balanceRatio = balanceAmount / (supply + bias);
-   
-    // evaluate asymmetric sigmoid [min, max)    
-    double e = std::exp(-balanceRatio * k);    
-    double sigmoid = minY + (diff / std::pow(1 + e, v));
+    // Moving inputs of stepped products have to be stepped with them, in reverse topological order
+    for (size_t index = count; index-- > 0;) {
+        if (!stepping[index]) continue;
+        for (uint32_t k = materials.rowOffsets[index]; k < materials.rowOffsets[index + 1]; k++) {
+            if (!stationary[materials.inputs[k]]) stepping[materials.inputs[k]] = 1;
+        }
+    }
+
+    // Closed form of N exponential adjustments toward a constant target
+    std::vector<ProductIndex> stepped;
+    for (size_t index = 0; index < count; index++) {
+        if (stepping[index]) {
+            stepped.push_back(ProductIndex(index));
+            continue;
+        }
+        Price target = state.cost[index] * (1.0 + state.floorMargin[index]) * state.multiplier[index];
+        double decay = std::pow(1.0 - 1.0 / state.turnover[index], double(ticks));
+        state.price[index] = target + decay * (state.price[index] - target);
+    }
+
+    // The rest is evaluated tick by tick as usual
+    for (size_t tick = 0; tick < ticks; tick++) {
+        for (ProductIndex index : stepped) adjustProductPrice(index);
+    }
+
+    if (incremental) markAllDirty();
+}
+
+
+void ProductsPricer::markDirty(size_t index) {
+    if (dirty[index]) return;
+    dirty[index] = 1;
+    dirtyLevels[levels[index]].push_back(ProductIndex(index));
+}
+
+
+void ProductsPricer::markAllDirty() {
+    PricingKernels::evaluateMultipliers(pricingKernel, state.demand.data(), state.supply.data(),
+        state.importance.data(), state.multiplier.data(), info.size(), pricingPrecision);
+    propagatedPrice = state.price;
+    for (size_t index = 0; index < info.size(); index++) markDirty(index);
+}
+
+
+void ProductsPricer::setIncrementalPricing(bool enabled, double epsilon) {
+    // Changes are not tracked in full mode, reprice everything once after switching
+    if (enabled && !incremental) markAllDirty();
+    incremental = enabled;
+    this->epsilon = epsilon;
+}
+
+
+bool ProductsPricer::isIncrementalPricing() const {
+    return incremental;
+}
+
+
+size_t ProductsPricer::getRepricedCount() const {
+    return repricedCount;
+}
+
+
+PricingPrecision ProductsPricer::getPricingPrecision() const {
+    return pricingPrecision;
+}
+
+
+void ProductsPricer::setPricingPrecision(PricingPrecision precision) {
+    pricingPrecision = precision;
+    // Cached multipliers were evaluated with the previous precision
+    if (incremental) markAllDirty();
+}
+
+
+size_t ProductsPricer::getLevelsCount() const {
+    return levelOffsets.empty() ? 0 : levelOffsets.size() - 1;
+}
+
+
+void ProductsPricer::setThreadPool(ThreadPool* pool) {
+    threadPool = pool;
+}
+
+
+void ProductsPricer::evaluateProductPrice(size_t index) {
+    state.multiplier[index] = PricingKernels::evaluateMultiplier(state.demand[index], state.supply[index], state.importance[index], pricingPrecision);
+    adjustProductPrice(index);
+}
+
+
+void ProductsPricer::adjustProductPrice(size_t index) {
 
     // Update product cost using bill of materials
-    evaluateProductCost(product);
+    evaluateProductCost(index);
 
     // Add minimal industry margin to the cost
-    double basePrice = product.cost * (1.0 + product.floorMargin);
+    double basePrice = state.cost[index] * (1.0 + state.floorMargin[index]);
 
     // evaluate target price
-    Money targetPrice = basePrice * std::clamp(sigmoid, minY, maxY);
+    Price targetPrice = basePrice * state.multiplier[index];
     
     // Exponential price adjustment toward target value
     // turnover - average inventory turnover period in days/ticks
-    double speedOfAdjustment = 1.0 / product.turnover;
-    product.price += speedOfAdjustment * (targetPrice - product.price);
+    double speedOfAdjustment = 1.0 / state.turnover[index];
+    state.price[index] += speedOfAdjustment * (targetPrice - state.price[index]);
 }
 
 
-void ProductsPricer::evaluateProductCost(Product& product) {
+void ProductsPricer::evaluateProductCost(size_t index) {
 
-    const BillOfMaterials& billOfMaterials = product.materials;
+    // Row of the sparse BoM matrix times prices vector
+    const uint32_t begin = materials.rowOffsets[index];
+    const uint32_t end = materials.rowOffsets[index + 1];
+    const ProductIndex* inputs = materials.inputs.data();
+    const Quantity* quantities = materials.quantities.data();
+    const Price* prices = state.price.data();
 
-    Money cost = 0;
+    Price cost = 0;
 
-    if (billOfMaterials.size() > 0) {
-        for (const Item& component : billOfMaterials) {
-            // straightforward non recursive approach
-            Money price = getProductPrice(component.productID);            
-            cost += price * component.quantity;
+    if (begin != end) {
+        for (uint32_t k = begin; k < end; k++) {
+            cost += prices[inputs[k]] * quantities[k];
         }
-        product.cost = cost;
+        state.cost[index] = cost;
     }     
 
-}
\ No newline at end of file
+}
+
+
+void MaterialsMatrix::clear() {
+    rowOffsets.assign(1, 0);
+    inputs.clear();
+    quantities.clear();
+}
+
+
+void MaterialsMatrix::transpose(MaterialsMatrix& transposed) const {
+    // Counting sort of entries by column keeps consumers of every input in row order
+    size_t count = rows();
+    transposed.rowOffsets.assign(count + 1, 0);
+    transposed.inputs.resize(inputs.size());
+    transposed.quantities.resize(quantities.size());
+    for (ProductIndex input : inputs) transposed.rowOffsets[input + 1]++;
+    for (size_t row = 0; row < count; row++) transposed.rowOffsets[row + 1] += transposed.rowOffsets[row];
+    std::vector<uint32_t> position(transposed.rowOffsets.begin(), transposed.rowOffsets.end() - 1);
+    for (size_t row = 0; row < count; row++) {
+        for (uint32_t k = rowOffsets[row]; k < rowOffsets[row + 1]; k++) {
+            uint32_t target = position[inputs[k]]++;
+            transposed.inputs[target] = ProductIndex(row);
+            transposed.quantities[target] = quantities[k];
+        }
+    }
+}
+
+
+void MaterialsMatrix::appendRow(const BillOfMaterials& billOfMaterials, const ProductsIndex& indexByID) {
+    for (const Item& material : billOfMaterials) {
+        inputs.push_back(ProductIndex(indexByID.at(material.productID)));
+        quantities.push_back(material.quantity);
+    }
+    rowOffsets.push_back(uint32_t(inputs.size()));
+}
@@ -0,0 +1,114 @@
+/**
+ * =============================================================================
+ *
+ * @class TradeLedger
+ * @brief Columnar buffer of the tick trades and their postings by agent.
+ *
+ * Products clear in parallel and write trades to their own slots, one column
+ * per trade field, so slots of a product are a contiguous range of every
+ * column. Settlement compacts the slots in product order, which is the order
+ * of a single threaded settlement, and partitions postings by agent with a
+ * counting sort: every trade posts a purchase to its buyer and a sale to its
+ * seller. The sort is stable, postings of an agent keep trade order, so
+ * balances change by the same operations in the same order as trade by trade
+ * settlement, but every agent is visited once and agents are independent.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+
+using namespace Axionomy;
+
+
+/**
+*  @brief Sizes columns for trade slots of the tick, slots are not cleared
+*  @param slots number of trade slots
+*/
+void TradeLedger::resize(size_t slots) {
+    product.resize(slots);
+    buyer.resize(slots);
+    seller.resize(slots);
+    quantity.resize(slots);
+    price.resize(slots);
+    buyOrder.resize(slots);
+    sellOrder.resize(slots);
+    tradesCount = slots;
+}
+
+
+/**
+*  @brief Writes trade to its slot, slots of different products may be written concurrently
+*  @param slot trade slot
+*  @param trade trade between bid and ask agents
+*  @param bid handle of the resting bid, NO_ORDER for bid of one tick
+*  @param ask handle of the resting ask, NO_ORDER for ask of one tick
+*/
+void TradeLedger::write(size_t slot, const Trade& trade, OrderHandle bid, OrderHandle ask) {
+    product[slot] = trade.product;
+    buyer[slot] = trade.buyer;
+    seller[slot] = trade.seller;
+    quantity[slot] = trade.quantity;
+    price[slot] = trade.price;
+    buyOrder[slot] = bid;
+    sellOrder[slot] = ask;
+}
+
+
+/**
+*  @brief Moves used slots of every product to the front, in product order
+*  @param offsets first slot by dense product index
+*  @param counts trades count by dense product index
+*/
+void TradeLedger::compact(const std::vector<size_t>& offsets, const std::vector<size_t>& counts) {
+    size_t count = 0;
+    for (size_t index = 0; index < counts.size(); index++) {
+        size_t first = offsets[index], last = offsets[index] + counts[index];
+        if (first != count) {
+            std::copy(product.begin() + first, product.begin() + last, product.begin() + count);
+            std::copy(buyer.begin() + first, buyer.begin() + last, buyer.begin() + count);
+            std::copy(seller.begin() + first, seller.begin() + last, seller.begin() + count);
+            std::copy(quantity.begin() + first, quantity.begin() + last, quantity.begin() + count);
+            std::copy(price.begin() + first, price.begin() + last, price.begin() + count);
+            std::copy(buyOrder.begin() + first, buyOrder.begin() + last, buyOrder.begin() + count);
+            std::copy(sellOrder.begin() + first, sellOrder.begin() + last, sellOrder.begin() + count);
+        }
+        count += counts[index];
+    }
+    tradesCount = count;
+}
+
+
+/**
+*  @brief Groups postings of trades with positive quantity by agent: histogram,
+*         prefix sum and stable scatter in trade order
+*  @param agentsCount number of agents, agent IDs of trades are below it
+*/
+void TradeLedger::partition(size_t agentsCount) {
+    agentOffsets.assign(agentsCount + 1, 0);
+    for (size_t i = 0; i < tradesCount; i++) {
+        if (!(quantity[i] > 0)) continue;
+        agentOffsets[buyer[i] + 1]++;
+        agentOffsets[seller[i] + 1]++;
+    }
+    for (size_t agent = 0; agent < agentsCount; agent++) agentOffsets[agent + 1] += agentOffsets[agent];
+
+    postings.resize(agentOffsets.back());
+    cursors.assign(agentOffsets.begin(), agentOffsets.end() - 1);
+    for (size_t i = 0; i < tradesCount; i++) {
+        if (!(quantity[i] > 0)) continue;
+        Money value = price[i] * quantity[i];
+        postings[cursors[buyer[i]]++] = Posting{ product[i], quantity[i], value };
+        postings[cursors[seller[i]]++] = Posting{ product[i], -quantity[i], value };
+    }
+}
+
+
+/**
+*  @brief Returns postings of agent in trade order, empty before partition
+*/
+std::span<const TradeLedger::Posting> TradeLedger::getPostings(AgentID agent) const {
+    if (agent + 1 >= agentOffsets.size()) return {};
+    return std::span<const Posting>(postings.data() + agentOffsets[agent], agentOffsets[agent + 1] - agentOffsets[agent]);
+}
@@ -0,0 +1,486 @@
+/**
+ * =============================================================================
+ *
+ * @class WorkloadGenerator
+ * @brief Generates reproducible synthetic products catalogs and agents
+ *        populations for scale testing.
+ *
+ * Products are spread over BoM levels: level zero holds labor and raw
+ * resources without inputs, every product of level L consumes up to fanIn
+ * products of lower levels, at least one of them from level L - 1, so the
+ * catalog has exactly the requested depth. Initial costs and prices are
+ * consistent with the bill of materials.
+ *
+ * Households and firms get sequential agent IDs (households first), firms
+ * are assigned produced products round-robin over the catalog. The saved
+ * population is loaded back into an engine by loadAgents, which streams the
+ * file, checks its schema and agent IDs and only then adds the agents.
+ *
+ * The same configuration and seed always produce the same workload.
+ *
+ * (C) Axionomy, Bolat Basheyev 2025
+ *
+ * ============================================================================= */
+#include "engine/MarketEngine.h"
+
+#include <fstream>
+#include <random>
+
+
+using namespace Axionomy;
+
+
+namespace {
+
+    /**
+    *  @class AgentsSaxHandler
+    *  @brief Streaming agents population parser built on nlohmann SAX events.
+    *
+    *  Tracks the nesting level of the document (population object, households
+    *  or firms array, agent object, inventory array, inventory item), checks
+    *  each value against the schema the moment it is read and appends complete
+    *  agents to flat records, so millions of agents never form a JSON DOM.
+    *  Values of unknown keys are skipped, including nested objects and arrays.
+    */
+    class AgentsSaxHandler : public nlohmann::json_sax<json> {
+    public:
+
+        // Agent of the population, its inventory is a range of the items
+        struct AgentRecord {
+            EconomicAgentType type;
+            Money cash;
+            size_t firstItem;
+            size_t itemsCount;
+        };
+
+        AgentsSaxHandler(const MarketEngine& engine) : engine(engine), firstAgentID(engine.getAgentsCount()) {}
+
+        const std::string& getError() const { return error; }
+        const std::vector<AgentRecord>& getAgents() const { return agents; }
+        const std::vector<Item>& getItems() const { return items; }
+
+        bool null() override { return scalar(); }
+        bool boolean(bool) override { return scalar(); }
+        bool number_integer(number_integer_t val) override { return val < 0 ? number(double(val)) : integer(uint64_t(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return integer(val); }
+        bool number_float(number_float_t val, const string_t&) override { return number(val); }
+        bool binary(binary_t&) override { return scalar(); }
+        bool string(string_t&) override { return scalar(); }
+        bool start_object(std::size_t elements) override;
+        bool key(string_t& val) override;
+        bool end_object() override;
+        bool start_array(std::size_t elements) override;
+        bool end_array() override;
+        bool parse_error(std::size_t position, const std::string& lastToken, const nlohmann::detail::exception& ex) override;
+
+    private:
+
+        // Document nesting levels
+        enum class Level : uint8_t { Root, Population, Agents, Agent, Inventory, Item, Done };
+
+        // Known population, agent and inventory item fields
+        enum Field : uint32_t {
+            AgentIDField   = 1 << 0,  CashField      = 1 << 1,
+            DebtField      = 1 << 2,  ProductField   = 1 << 3,
+            InventoryField = 1 << 4,  ProductIDField = 1 << 5,
+            QuantityField  = 1 << 6,  HouseholdsField = 1 << 7,
+            FirmsField     = 1 << 8,  UnknownField   = 0
+        };
+
+        static constexpr uint32_t householdFields = AgentIDField | CashField | DebtField;
+        static constexpr uint32_t firmFields = householdFields | ProductField;
+        static constexpr uint32_t itemFields = ProductIDField | QuantityField;
+        static constexpr uint32_t populationFields = HouseholdsField | FirmsField;
+
+        const MarketEngine& engine;            // Engine the agents are validated against
+        const AgentID firstAgentID;            // ID of the first loaded agent
+        std::vector<AgentRecord> agents;       // Output agents
+        std::vector<Item> items;               // Output inventories
+        AgentRecord agent{};                   // Agent being parsed
+        Item item{};                           // Inventory item being parsed
+        Level level = Level::Root;             // Current nesting level
+        uint32_t field = UnknownField;         // Field of the current key
+        uint32_t fieldsRead = 0;               // Fields read in the current agent or item
+        uint32_t listsRead = 0;                // Agent lists read in the population
+        size_t skipDepth = 0;                  // Nesting depth of skipped value
+        std::string error;                     // Validation error message
+
+        bool fail(const std::string& message);
+        bool unexpected();
+        bool scalar();
+        bool integer(uint64_t value);
+        bool number(double value);
+        bool finishAgent();
+    };
+
+
+    bool AgentsSaxHandler::fail(const std::string& message) {
+        error = "agent #" + std::to_string(agents.size()) + ": " + message;
+        return false;
+    }
+
+
+    bool AgentsSaxHandler::unexpected() {
+        switch (level) {
+        case Level::Root:      return fail("population must be an object of households and firms");
+        case Level::Agents:    return fail("agent entry must be an object");
+        case Level::Inventory: return fail("inventory entry must be an object");
+        default:               return fail("invalid value type");
+        }
+    }
+
+
+    bool AgentsSaxHandler::scalar() {
+        if (skipDepth > 0) return true;
+        if ((level == Level::Population || level == Level::Agent || level == Level::Item) && field == UnknownField) return true;
+        return unexpected();
+    }
+
+
+    bool AgentsSaxHandler::integer(uint64_t value) {
+        if (skipDepth > 0) return true;
+        if (level != Level::Agent && level != Level::Item) return scalar();
+        switch (field) {
+        case AgentIDField:
+            if (value != firstAgentID + agents.size()) return fail("agentID must be " + std::to_string(firstAgentID + agents.size()));
+            break;
+        case ProductField:
+            if (!engine.hasProduct(ProductID(value))) return fail("unknown product " + std::to_string(value));
+            break;
+        case ProductIDField:
+            if (!engine.hasProduct(ProductID(value))) return fail("unknown inventory product " + std::to_string(value));
+            item.productID = ProductID(value);
+            break;
+        default:
+            return number(double(value));
+        }
+        fieldsRead |= field;
+        return true;
+    }
+
+
+    bool AgentsSaxHandler::number(double value) {
+        if (skipDepth > 0) return true;
+        if (level != Level::Agent && level != Level::Item) return scalar();
+        switch (field) {
+        case UnknownField: return true;
+        case CashField:
+            if (!(value >= 0)) return fail("cash must be non-negative");
+            agent.cash = Money(value);
+            break;
+        case DebtField:
+            if (value != 0) return fail("debt is not supported by the engine, it must be zero");
+            break;
+        case QuantityField:
+            if (!(value >= 0)) return fail("inventory quantity must be non-negative");
+            item.quantity = value;
+            break;
+        case AgentIDField:   return fail("agentID must be a non-negative integer");
+        case ProductField:   return fail("product must be a non-negative integer");
+        case ProductIDField: return fail("inventory productID must be a non-negative integer");
+        default:             return fail("invalid value type");
+        }
+        fieldsRead |= field;
+        return true;
+    }
+
+
+    bool AgentsSaxHandler::key(string_t& val) {
+        if (skipDepth > 0) return true;
+        field = UnknownField;
+        if (level == Level::Population) {
+            if (val == "households") field = HouseholdsField;
+            else if (val == "firms") field = FirmsField;
+        } else if (level == Level::Agent) {
+            if (val == "agentID") field = AgentIDField;
+            else if (val == "cash") field = CashField;
+            else if (val == "debt") field = DebtField;
+            else if (val == "inventory") field = InventoryField;
+            else if (val == "product" && agent.type == EconomicAgentType::Firm) field = ProductField;
+        } else if (level == Level::Item) {
+            if (val == "productID") field = ProductIDField;
+            else if (val == "quantity") field = QuantityField;
+        }
+        return true;
+    }
+
+
+    bool AgentsSaxHandler::start_object(std::size_t) {
+        if (skipDepth > 0) { skipDepth++; return true; }
+        switch (level) {
+        case Level::Root:
+            level = Level::Population;
+            return true;
+        case Level::Agents:
+            agent.cash = Money(0);
+            agent.firstItem = items.size();
+            agent.itemsCount = 0;
+            fieldsRead = 0;
+            level = Level::Agent;
+            return true;
+        case Level::Inventory:
+            item = Item{};
+            fieldsRead &= ~itemFields;
+            level = Level::Item;
+            return true;
+        case Level::Population:
+        case Level::Agent:
+        case Level::Item:
+            if (field != UnknownField) return unexpected();
+            skipDepth = 1;
+            return true;
+        default:
+            return unexpected();
+        }
+    }
+
+
+    bool AgentsSaxHandler::end_object() {
+        if (skipDepth > 0) { skipDepth--; return true; }
+        switch (level) {
+        case Level::Item:
+            if ((fieldsRead & itemFields) != itemFields) return fail("inventory item requires productID and quantity");
+            items.push_back(item);
+            agent.itemsCount++;
+            level = Level::Inventory;
+            return true;
+        case Level::Agent:
+            return finishAgent();
+        default:
+            if ((listsRead & populationFields) != populationFields) return fail("population requires households and firms");
+            level = Level::Done;
+            return true;
+        }
+    }
+
+
+    bool AgentsSaxHandler::start_array(std::size_t) {
+        if (skipDepth > 0) { skipDepth++; return true; }
+        switch (level) {
+        case Level::Population:
+            if (field == UnknownField) { skipDepth = 1; return true; }
+            agent.type = field == HouseholdsField ? EconomicAgentType::Household : EconomicAgentType::Firm;
+            listsRead |= field;
+            level = Level::Agents;
+            return true;
+        case Level::Agent:
+            if (field == UnknownField) { skipDepth = 1; return true; }
+            if (field != InventoryField) return unexpected();
+            level = Level::Inventory;
+            return true;
+        case Level::Item:
+            if (field == UnknownField) { skipDepth = 1; return true; }
+            return unexpected();
+        default:
+            return unexpected();
+        }
+    }
+
+
+    bool AgentsSaxHandler::end_array() {
+        if (skipDepth > 0) { skipDepth--; return true; }
+        level = level == Level::Inventory ? Level::Agent : Level::Population;
+        return true;
+    }
+
+
+    bool AgentsSaxHandler::finishAgent() {
+        level = Level::Agents;
+        uint32_t required = agent.type == EconomicAgentType::Firm ? firmFields : householdFields;
+        if ((fieldsRead & required) != required) return fail("missing required fields");
+        agents.push_back(agent);
+        return true;
+    }
+
+
+    bool AgentsSaxHandler::parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) {
+        error = "parse error at byte " + std::to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+}
+
+
+/**
+*  @brief Fills configuration with one of predefined workloads
+*  @param name preset name: small, medium or huge
+*  @param config output configuration
+*  @return true if preset exists, false otherwise
+*/
+bool WorkloadGenerator::getPreset(const std::string& name, WorkloadConfig& config) {
+    config = WorkloadConfig{};
+    if (name == "small") {
+        config.productsCount = 1000;
+        config.depth = 4;
+        config.fanIn = 3;
+        config.householdsCount = 10000;
+        config.firmsCount = 1000;
+    } else if (name == "medium") {
+        config.productsCount = 100000;
+        config.depth = 8;
+        config.fanIn = 5;
+        config.householdsCount = 1000000;
+        config.firmsCount = 100000;
+    } else if (name == "huge") {
+        config.productsCount = 1000000;
+        config.depth = 12;
+        config.fanIn = 8;
+        config.householdsCount = 5000000;
+        config.firmsCount = 1000000;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+/**
+*  @brief Generates products catalog in topological order
+*  @param config workload configuration
+*  @param products output vector of products
+*/
+void WorkloadGenerator::generateProducts(const WorkloadConfig& config, ProductsList& products) {
+
+    std::mt19937_64 random(config.seed);
+    auto uniform = [&random](double min, double max) {
+        return std::uniform_real_distribution<double>(min, max)(random);
+    };
+    auto importance = [&]() {
+        double value = config.importanceMean;
+        switch (config.importance) {
+        case ImportanceDistribution::Uniform:
+            value = uniform(config.importanceMean - config.importanceSpread, config.importanceMean + config.importanceSpread);
+            break;
+        case ImportanceDistribution::Normal:
+            value = std::normal_distribution<double>(config.importanceMean, config.importanceSpread)(random);
+            break;
+        case ImportanceDistribution::Exponential:
+            value = std::exponential_distribution<double>(1.0 / std::max(config.importanceMean, 1e-6))(random);
+            break;
+        }
+        return std::clamp(value, 0.0, 1.0);
+    };
+
+    const size_t count = config.productsCount;
+    const size_t depth = std::clamp<size_t>(config.depth, 1, std::max<size_t>(count, 1));
+    const size_t fanIn = std::max<size_t>(config.fanIn, 1);
+    auto levelStart = [&](size_t level) { return level * count / depth; };
+
+    products.clear();
+    products.reserve(count);
+
+    for (size_t level = 0; level < depth; level++) {
+        for (size_t id = levelStart(level); id < levelStart(level + 1); id++) {
+            Product& product = products.emplace_back();
+            product.productID = id;
+            product.importance = importance();
+            product.turnover = std::round(uniform(2, 30));
+            product.demand = product.supply = std::round(uniform(100, 10000));
+
+            if (level == 0) {
+                // Labor and raw resources
+                bool labor = id % 10 == 0;
+                product.name = (labor ? "Labor " : "Resource ") + std::to_string(id);
+                product.type = labor ? ProductType::Service : ProductType::Good;
+                product.unit = labor ? ProductUnit::Hour : ProductUnit::Kg;
+                product.floorMargin = 0;
+                product.cost = product.price = std::round(uniform(1, 20) * 100) / 100;
+                continue;
+            }
+
+            // Intermediate and final goods consume products of lower levels
+            product.name = "Product " + std::to_string(id);
+            product.type = ProductType::Good;
+            product.unit = ProductUnit::Piece;
+            product.floorMargin = std::round(uniform(0.05, 0.5) * 100) / 100;
+
+            size_t below = levelStart(level);
+            size_t previous = levelStart(level - 1);
+            size_t inputsCount = 1 + random() % std::min(fanIn, below);
+            product.materials.reserve(inputsCount);
+            product.cost = 0;
+            while (product.materials.size() < inputsCount) {
+                size_t first = product.materials.empty() ? previous : 0;
+                ProductID input = first + random() % (below - first);
+                bool duplicate = std::any_of(product.materials.begin(), product.materials.end(),
+                    [input](const Item& item) { return item.productID == input; });
+                if (duplicate) continue;
+                double quantity = std::round(uniform(0.5, 5) * 10) / 10;
+                product.materials.push_back({ input, quantity });
+                product.cost += products[input].price * quantity;
+            }
+            product.price = product.cost * (1.0 + product.floorMargin);
+        }
+    }
+}
+
+
+/**
+*  @brief Generates agents population matching products catalog and saves it to JSON
+*  @param path output JSON file path
+*  @param config workload configuration
+*  @param products products catalog generated for the same configuration
+*  @return true if the file was written, false otherwise
+*/
+bool WorkloadGenerator::saveAgents(const std::string& path, const WorkloadConfig& config, const ProductsList& products) {
+
+    if (products.empty()) return false;
+    std::ofstream agentsFile(path, std::ios::trunc);
+    if (!agentsFile.is_open()) return false;
+
+    std::mt19937_64 random(config.seed ^ 0x9E3779B97F4A7C15ULL);
+    auto uniform = [&random](double min, double max) {
+        return std::round(std::uniform_real_distribution<double>(min, max)(random));
+    };
+
+    // Population is streamed as text, millions of agents do not fit a JSON DOM comfortably
+    AgentID agentID = 0;
+    agentsFile << "{\n  \"households\": [\n";
+    for (size_t i = 0; i < config.householdsCount; i++, agentID++) {
+        agentsFile << "    { \"agentID\": " << agentID << ", \"cash\": " << uniform(1000, 100000) << ", \"debt\": 0 }"
+            << (i + 1 < config.householdsCount ? ",\n" : "\n");
+    }
+    agentsFile << "  ],\n  \"firms\": [\n";
+    for (size_t i = 0; i < config.firmsCount; i++, agentID++) {
+        const Product& product = products[i % products.size()];
+        agentsFile << "    { \"agentID\": " << agentID << ", \"product\": " << product.productID
+            << ", \"cash\": " << uniform(10000, 1000000) << ", \"debt\": 0, \"inventory\": [ { \"productID\": "
+            << product.productID << ", \"quantity\": " << uniform(10, 1000) << " } ] }"
+            << (i + 1 < config.firmsCount ? ",\n" : "\n");
+    }
+    agentsFile << "  ]\n}\n";
+    return bool(agentsFile);
+}
+
+
+
+/**
+*  @brief Loads agents population saved by saveAgents into engine: households
+*         and firms with their cash and inventories. The whole file is
+*         validated before the first agent is added, so a rejected file
+*         leaves the engine unchanged.
+*  @param path population JSON file path
+*  @param engine engine with the catalog of the population, agent IDs of the
+*         file must continue the agents the engine already has
+*  @return number of loaded agents or zero if failed
+*/
+size_t WorkloadGenerator::loadAgents(const std::string& path, MarketEngine& engine) {
+
+    std::ifstream agentsFile(path, std::ios::binary);
+    if (!agentsFile.is_open()) return 0;
+    AgentsSaxHandler handler(engine);
+    if (!json::sax_parse(agentsFile, &handler)) {
+        std::cerr << "Invalid agents population: " << path << " (" << handler.getError() << ")\n";
+        return 0;
+    }
+
+    const std::vector<Item>& items = handler.getItems();
+    for (const AgentsSaxHandler::AgentRecord& record : handler.getAgents()) {
+        AgentID agent = record.type == EconomicAgentType::Household ? engine.addAgent(Household{}) : engine.addAgent(Firm{});
+        engine.deposit(agent, record.cash);
+        for (size_t i = record.firstItem; i < record.firstItem + record.itemsCount; i++) {
+            engine.deposit(agent, items[i].productID, items[i].quantity);
+        }
+    }
+    return handler.getAgents().size();
+}
@@ -0,0 +1,101 @@
+// AxionomyGenerator.cpp: synthetic workload generator for scale testing.
+//
+// Usage: AxionomyGenerator [options]
+//   --preset small|medium|huge    start from predefined workload, other options override it
+//   --products N                  number of products
+//   --depth N                     number of BoM levels
+//   --fan-in N                    maximum inputs per product
+//   --importance uniform|normal|exponential[:mean[:spread]]
+//   --households N                number of households
+//   --firms N                     number of firms
+//   --seed N                      random generator seed
+//   --format json|axc|both        catalog format (default both)
+//   --out PREFIX                  output prefix (default data/workload)
+//
+// Writes PREFIX.json and/or PREFIX.axc catalog and PREFIX_agents.json population.
+
+#include "engine/MarketEngine.h"
+
+#include <chrono>
+#include <sstream>
+
+using namespace std;
+using namespace Axionomy;
+
+
+bool parseImportance(const std::string& value, WorkloadConfig& config) {
+	std::stringstream stream(value);
+	std::string name, mean, spread;
+	std::getline(stream, name, ':');
+	std::getline(stream, mean, ':');
+	std::getline(stream, spread, ':');
+	if (name == "uniform") config.importance = ImportanceDistribution::Uniform;
+	else if (name == "normal") config.importance = ImportanceDistribution::Normal;
+	else if (name == "exponential") config.importance = ImportanceDistribution::Exponential;
+	else return false;
+	if (!mean.empty()) config.importanceMean = std::stod(mean);
+	if (!spread.empty()) config.importanceSpread = std::stod(spread);
+	return true;
+}
+
+
+int main(int argc, char* argv[])
+{
+	WorkloadConfig config;
+	std::string format = "both";
+	std::string prefix = "data/workload";
+
+	try {
+		// Preset is applied first wherever it is given, so it never discards other options
+		for (int i = 1; i + 1 < argc; i += 2) {
+			std::string value = argv[i + 1];
+			if (std::string(argv[i]) == "--preset" && !WorkloadGenerator::getPreset(value, config)) {
+				throw std::invalid_argument("unknown preset " + value);
+			}
+		}
+		for (int i = 1; i + 1 < argc; i += 2) {
+			std::string option = argv[i];
+			std::string value = argv[i + 1];
+			if (option == "--preset") continue;
+			else if (option == "--products") config.productsCount = std::stoull(value);
+			else if (option == "--depth") config.depth = std::stoull(value);
+			else if (option == "--fan-in") config.fanIn = std::stoull(value);
+			else if (option == "--households") config.householdsCount = std::stoull(value);
+			else if (option == "--firms") config.firmsCount = std::stoull(value);
+			else if (option == "--seed") config.seed = std::stoull(value);
+			else if (option == "--format") format = value;
+			else if (option == "--out") prefix = value;
+			else if (option == "--importance") {
+				if (!parseImportance(value, config)) throw std::invalid_argument("unknown distribution " + value);
+			}
+			else throw std::invalid_argument("unknown option " + option);
+		}
+	}
+	catch (const std::exception& e) {
+		cerr << "Invalid arguments: " << e.what() << endl;
+		return 1;
+	}
+
+	if (config.productsCount == 0 || (format != "json" && format != "axc" && format != "both")) {
+		cerr << "Invalid workload configuration" << endl;
+		return 1;
+	}
+
+	auto start = chrono::steady_clock::now();
+	ProductsList products;
+	WorkloadGenerator::generateProducts(config, products);
+
+	bool written = true;
+	if (format != "axc") written &= ProductsLoader::saveProductList(prefix + ".json", products);
+	if (format != "json") written &= ProductsLoader::saveProductImage(prefix + ".axc", products);
+	written &= WorkloadGenerator::saveAgents(prefix + "_agents.json", config, products);
+	if (!written) {
+		cerr << "Failed to write workload " << prefix << endl;
+		return 1;
+	}
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	cout << "Generated " << products.size() << " products, " << config.householdsCount << " households, "
+		<< config.firmsCount << " firms to " << prefix << " in " << elapsed.count() << " s" << endl;
+	return 0;
+}